@@ -4,6 +4,7 @@
 
 #define CRT0_EXIT
 #include "crt0.h"
+#include "sim_host.h"
 
 extern void __attribute__((used)) __section(".init")
 _cstart(void)
@@ -13,10 +14,7 @@ _cstart(void)
 
 __attribute__((__noreturn__)) void _exit(int status)
 {
-    volatile char * sim_out = (volatile char*)0x801FFFFC;
-
-    if (status != 0) *sim_out = 0xff;
-    else *sim_out = 0x00;
+    sim_exit(status);
 
     for (;;) {}
 }
@@ -0,0 +1,105 @@
+#ifndef __HPM_H
+#define __HPM_H
+
+#include <stdint.h>
+#include <system.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Ibex hardware performance counters. The events are fixed, counter N counts
+ * event N. Only the counters selected by HPM_COUNTERS at model build time are
+ * implemented (see README.md), the others read as 0.
+ *
+ * Reference : https://ibex-core.readthedocs.io/en/latest/03_reference/performance_counters.html
+ */
+#define HPM_LOAD_WAIT       3   /* Cycles waiting for data memory */
+#define HPM_FETCH_WAIT      4   /* Cycles waiting for instruction fetches */
+#define HPM_LOADS           5
+#define HPM_STORES          6
+#define HPM_JUMPS           7
+#define HPM_BRANCHES        8   /* Conditional branches */
+#define HPM_BRANCHES_TAKEN  9
+#define HPM_COMPRESSED      10  /* Retired compressed instructions */
+#define HPM_MUL_WAIT        11
+#define HPM_DIV_WAIT        12
+
+/* mcountinhibit bits of the event counters, mcycle and minstret excluded */
+#define HPM_COUNTERS_MASK   0x1ff8
+
+struct hpm_sample_s {
+	uint32_t cycles;
+	uint32_t instret;
+	uint32_t load_wait;
+	uint32_t fetch_wait;
+	uint32_t loads;
+	uint32_t stores;
+	uint32_t jumps;
+	uint32_t branches;
+	uint32_t branches_taken;
+	uint32_t compressed;
+};
+
+/* Bits of the implemented event counters in mcountinhibit */
+__attribute__((unused)) static uint32_t hpm_counters(void) {
+	uint32_t inhibit = csrr(mcountinhibit);
+	uint32_t implemented;
+	csrs(mcountinhibit, HPM_COUNTERS_MASK);
+	implemented = csrr(mcountinhibit) & HPM_COUNTERS_MASK;
+	csrw(mcountinhibit, inhibit);
+	return implemented;
+}
+
+/* mcycle and minstret keep counting, the SDRAM code waits on mcycle */
+__attribute__((unused)) static void hpm_start(void) {
+	csrc(mcountinhibit, HPM_COUNTERS_MASK);
+}
+
+__attribute__((unused)) static void hpm_stop(void) {
+	csrs(mcountinhibit, HPM_COUNTERS_MASK);
+}
+
+__attribute__((unused)) static void hpm_clear(void) {
+	csrw(mhpmcounter3, 0);
+	csrw(mhpmcounter4, 0);
+	csrw(mhpmcounter5, 0);
+	csrw(mhpmcounter6, 0);
+	csrw(mhpmcounter7, 0);
+	csrw(mhpmcounter8, 0);
+	csrw(mhpmcounter9, 0);
+	csrw(mhpmcounter10, 0);
+	csrw(mhpmcounter11, 0);
+	csrw(mhpmcounter12, 0);
+}
+
+__attribute__((unused)) static void hpm_read(struct hpm_sample_s *sample) {
+	sample->cycles         = csrr(mcycle);
+	sample->instret        = csrr(minstret);
+	sample->load_wait      = csrr(mhpmcounter3);
+	sample->fetch_wait     = csrr(mhpmcounter4);
+	sample->loads          = csrr(mhpmcounter5);
+	sample->stores         = csrr(mhpmcounter6);
+	sample->jumps          = csrr(mhpmcounter7);
+	sample->branches       = csrr(mhpmcounter8);
+	sample->branches_taken = csrr(mhpmcounter9);
+	sample->compressed     = csrr(mhpmcounter10);
+}
+
+/* Counts of a code region, from the samples at its start and end */
+__attribute__((unused)) static void hpm_diff(struct hpm_sample_s *region,
+	const struct hpm_sample_s *start, const struct hpm_sample_s *end) {
+	const uint32_t *s = (const uint32_t *)start;
+	const uint32_t *e = (const uint32_t *)end;
+	uint32_t *r = (uint32_t *)region;
+	unsigned int i;
+	for (i = 0; i < sizeof(*region)/sizeof(uint32_t); i++)
+		r[i] = e[i] - s[i];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HPM_H */
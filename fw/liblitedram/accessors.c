@@ -1,24 +1,52 @@
 #include <stdio.h>
 
 #include <liblitedram/accessors.h>
+#include <liblitedram/sdram.h>
 
 #if defined(CSR_SDRAM_BASE) && defined(CSR_DDRPHY_BASE)
 
+/*
+ * Iterates over the modules set in a module mask. The empty branch keeps an
+ * else following the loop body from binding to the mask check.
+ */
+#define for_each_module(module, modules) \
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) \
+		if (!((modules) & (1 << module))) {} else
+
+/*
+ * The *_modules() actions take a mask of modules. Their CSR write acts on all
+ * modules selected in the PHY at once, so they are meant to be used through
+ * sdram_leveling_action_modules() with the same mask. The single module
+ * actions apply them to a mask of one module.
+ */
+
 #if defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
 
 int read_dq_delay[SDRAM_PHY_MODULES];
-void read_inc_dq_delay(int module) {
+void read_inc_dq_delay_modules(unsigned int modules) {
+	int module;
 	/* Increment delay */
-	read_dq_delay[module] = (read_dq_delay[module] + 1) & (SDRAM_PHY_DELAYS - 1);
+	for_each_module(module, modules)
+		read_dq_delay[module] = (read_dq_delay[module] + 1) & (SDRAM_PHY_DELAYS - 1);
 	ddrphy_rdly_dq_inc_write(1);
 }
 
-void read_rst_dq_delay(int module) {
+void read_rst_dq_delay_modules(unsigned int modules) {
+	int module;
 	/* Reset delay */
-	read_dq_delay[module] = 0;
+	for_each_module(module, modules)
+		read_dq_delay[module] = 0;
 	ddrphy_rdly_dq_rst_write(1);
 }
 
+void read_inc_dq_delay(int module) {
+	read_inc_dq_delay_modules(1 << module);
+}
+
+void read_rst_dq_delay(int module) {
+	read_rst_dq_delay_modules(1 << module);
+}
+
 #endif // defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
 
 #if defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
@@ -27,69 +55,112 @@ int sdram_clock_delay;
 void sdram_inc_clock_delay(void) {
 	sdram_clock_delay = (sdram_clock_delay + 1) & (SDRAM_PHY_DELAYS - 1);
 	ddrphy_cdly_inc_write(1);
-	cdelay(100);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
 }
 
 void sdram_rst_clock_delay(void) {
 	sdram_clock_delay = 0;
 	ddrphy_cdly_rst_write(1);
-	cdelay(100);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
 }
 
 int write_dq_delay[SDRAM_PHY_MODULES];
-void write_inc_dq_delay(int module) {
+void write_inc_dq_delay_modules(unsigned int modules) {
+	int module;
 	/* Increment DQ delay */
-	write_dq_delay[module] = (write_dq_delay[module] + 1) & (SDRAM_PHY_DELAYS - 1);
+	for_each_module(module, modules)
+		write_dq_delay[module] = (write_dq_delay[module] + 1) & (SDRAM_PHY_DELAYS - 1);
 	ddrphy_wdly_dq_inc_write(1);
-	cdelay(100);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
 }
 
-void write_rst_dq_delay(int module) {
+void write_rst_dq_delay_modules(unsigned int modules) {
+	int module;
 #if defined(SDRAM_PHY_USDDRPHY) || defined(SDRAM_PHY_USPDDRPHY)
-	/* Reset DQ delay */
-	int dq_count = ddrphy_wdly_dqs_inc_count_read();
-	while (dq_count != SDRAM_PHY_DELAYS) {
-		ddrphy_wdly_dq_inc_write(1);
-		cdelay(100);
-		dq_count++;
+	/* Reset DQ delay, the tap count is read back one module at a time */
+	for_each_module(module, modules) {
+		ddrphy_dly_sel_write(1 << module);
+		int dq_count = ddrphy_wdly_dqs_inc_count_read();
+		while (dq_count != SDRAM_PHY_DELAYS) {
+			ddrphy_wdly_dq_inc_write(1);
+			sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+			dq_count++;
+		}
 	}
+	ddrphy_dly_sel_write(modules);
 #else
 	/* Reset DQ delay */
 	ddrphy_wdly_dq_rst_write(1);
-	cdelay(100);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
 #endif //defined(SDRAM_PHY_USDDRPHY) || defined(SDRAM_PHY_USPDDRPHY)
-	write_dq_delay[module] = 0;
+	for_each_module(module, modules)
+		write_dq_delay[module] = 0;
 }
 
-void write_inc_dqs_delay(int module) {
+int write_dqs_delay[SDRAM_PHY_MODULES];
+void write_inc_dqs_delay_modules(unsigned int modules) {
+	int module;
 	/* Increment DQS delay */
+	for_each_module(module, modules)
+		write_dqs_delay[module] = (write_dqs_delay[module] + 1) & (SDRAM_PHY_DELAYS - 1);
 	ddrphy_wdly_dqs_inc_write(1);
-	cdelay(100);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
 }
 
-void write_rst_dqs_delay(int module) {
+void write_rst_dqs_delay_modules(unsigned int modules) {
+	int module;
+	for_each_module(module, modules)
+		write_dqs_delay[module] = 0;
 #if defined(SDRAM_PHY_USDDRPHY) || defined(SDRAM_PHY_USPDDRPHY)
-	/* Reset DQS delay */
-	while (ddrphy_wdly_dqs_inc_count_read() != 0) {
-		ddrphy_wdly_dqs_inc_write(1);
-		cdelay(100);
+	/* Reset DQS delay, the tap count is read back one module at a time */
+	for_each_module(module, modules) {
+		ddrphy_dly_sel_write(1 << module);
+		while (ddrphy_wdly_dqs_inc_count_read() != 0) {
+			ddrphy_wdly_dqs_inc_write(1);
+			sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+		}
 	}
+	ddrphy_dly_sel_write(modules);
 #else
 	/* Reset DQS delay */
 	ddrphy_wdly_dqs_rst_write(1);
-	cdelay(100);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
 #endif //defined(SDRAM_PHY_USDDRPHY) || defined(SDRAM_PHY_USPDDRPHY)
 }
 
-void write_inc_delay(int module) {
+void write_inc_delay_modules(unsigned int modules) {
 	/* Increment DQ/DQS delay */
-	write_inc_dq_delay(module);
-	write_inc_dqs_delay(module);
+	write_inc_dq_delay_modules(modules);
+	write_inc_dqs_delay_modules(modules);
+}
+
+void write_rst_delay_modules(unsigned int modules) {
+	write_rst_dq_delay_modules(modules);
+	write_rst_dqs_delay_modules(modules);
+}
+
+void write_inc_dq_delay(int module) {
+	write_inc_dq_delay_modules(1 << module);
+}
+
+void write_rst_dq_delay(int module) {
+	write_rst_dq_delay_modules(1 << module);
+}
+
+void write_inc_dqs_delay(int module) {
+	write_inc_dqs_delay_modules(1 << module);
+}
+
+void write_rst_dqs_delay(int module) {
+	write_rst_dqs_delay_modules(1 << module);
+}
+
+void write_inc_delay(int module) {
+	write_inc_delay_modules(1 << module);
 }
 
 void write_rst_delay(int module) {
-	write_rst_dq_delay(module);
-	write_rst_dqs_delay(module);
+	write_rst_delay_modules(1 << module);
 }
 
 #endif // defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
@@ -97,36 +168,60 @@ void write_rst_delay(int module) {
 #if defined(SDRAM_PHY_BITSLIPS)
 
 int read_dq_bitslip[SDRAM_PHY_MODULES];
-void read_inc_dq_bitslip(int module) {
+void read_inc_dq_bitslip_modules(unsigned int modules) {
+	int module;
 	/* Increment bitslip */
-	read_dq_bitslip[module] = (read_dq_bitslip[module] + 1) & (SDRAM_PHY_BITSLIPS - 1);
+	for_each_module(module, modules)
+		read_dq_bitslip[module] = (read_dq_bitslip[module] + 1) & (SDRAM_PHY_BITSLIPS - 1);
 	ddrphy_rdly_dq_bitslip_write(1);
 }
 
-void read_rst_dq_bitslip(int module) {
-/* Reset bitslip */
-	read_dq_bitslip[module] = 0;
+void read_rst_dq_bitslip_modules(unsigned int modules) {
+	int module;
+	/* Reset bitslip */
+	for_each_module(module, modules)
+		read_dq_bitslip[module] = 0;
 	ddrphy_rdly_dq_bitslip_rst_write(1);
 }
 
+void read_inc_dq_bitslip(int module) {
+	read_inc_dq_bitslip_modules(1 << module);
+}
+
+void read_rst_dq_bitslip(int module) {
+	read_rst_dq_bitslip_modules(1 << module);
+}
+
 int write_dq_bitslip[SDRAM_PHY_MODULES];
-void write_inc_dq_bitslip(int module) {
+void write_inc_dq_bitslip_modules(unsigned int modules) {
+	int module;
 	/* Increment bitslip */
-	write_dq_bitslip[module] = (write_dq_bitslip[module] + 1) & (SDRAM_PHY_BITSLIPS - 1);
+	for_each_module(module, modules)
+		write_dq_bitslip[module] = (write_dq_bitslip[module] + 1) & (SDRAM_PHY_BITSLIPS - 1);
 	ddrphy_wdly_dq_bitslip_write(1);
 }
 
-void write_rst_dq_bitslip(int module) {
-	/* Increment bitslip */
-	write_dq_bitslip[module] = 0;
+void write_rst_dq_bitslip_modules(unsigned int modules) {
+	int module;
+	/* Reset bitslip */
+	for_each_module(module, modules)
+		write_dq_bitslip[module] = 0;
 	ddrphy_wdly_dq_bitslip_rst_write(1);
 }
 
+void write_inc_dq_bitslip(int module) {
+	write_inc_dq_bitslip_modules(1 << module);
+}
+
+void write_rst_dq_bitslip(int module) {
+	write_rst_dq_bitslip_modules(1 << module);
+}
+
 #endif // defined(SDRAM_PHY_BITSLIPS)
 
 #if defined(CSR_DDRPHY_DLY_SEL_ADDR)
-void sdram_select(int module, int dq_line) {
-	ddrphy_dly_sel_write(1 << module);
+void sdram_select_modules(unsigned int modules, int dq_line) {
+	ddrphy_dly_sel_write(modules);
 
 #ifdef SDRAM_DELAY_PER_DQ
 	/* Select DQ line */
@@ -134,6 +229,10 @@ void sdram_select(int module, int dq_line) {
 #endif //SDRAM_DELAY_PER_DQ
 }
 
+void sdram_select(int module, int dq_line) {
+	sdram_select_modules(1 << module, dq_line);
+}
+
 void sdram_deselect(int module, int dq_line) {
 	ddrphy_dly_sel_write(0);
 
@@ -159,6 +258,158 @@ void sdram_leveling_action(int module, int dq_line, action_callback action) {
 	/* Un-select module */
 	sdram_deselect(module, dq_line);
 }
+
+void sdram_leveling_action_modules(unsigned int modules, int dq_line, modules_action_callback action) {
+	/* Select modules */
+	sdram_select_modules(modules, dq_line);
+
+	/* Action, applied to all of them by one CSR write */
+	action(modules);
+
+	/* Un-select modules */
+	sdram_deselect(0, dq_line);
+}
+
+/* Shadow value of a delay, the taps set since its last reset */
+static int *sdram_delay_shadow(enum sdram_delay_kind kind, int module) {
+	switch (kind) {
+#if defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
+	case SDRAM_DELAY_READ_DQ:
+		return &read_dq_delay[module];
+#endif // defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
+#if defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
+	case SDRAM_DELAY_WRITE_DQ:
+		return &write_dq_delay[module];
+	case SDRAM_DELAY_WRITE_DQS:
+		return &write_dqs_delay[module];
+	case SDRAM_DELAY_WRITE:
+		/* DQ and DQS move together, DQ stands for both */
+		return &write_dq_delay[module];
+	case SDRAM_DELAY_CLOCK:
+		return &sdram_clock_delay;
+#endif // defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
+	default:
+		return NULL;
+	}
+}
+
+void sdram_delay_modules_actions(enum sdram_delay_kind kind,
+	modules_action_callback *rst_delay, modules_action_callback *inc_delay) {
+	*rst_delay = NULL;
+	*inc_delay = NULL;
+	switch (kind) {
+#if defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
+	case SDRAM_DELAY_READ_DQ:
+		*rst_delay = read_rst_dq_delay_modules;
+		*inc_delay = read_inc_dq_delay_modules;
+		break;
+#endif // defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
+#if defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
+	case SDRAM_DELAY_WRITE_DQ:
+		*rst_delay = write_rst_dq_delay_modules;
+		*inc_delay = write_inc_dq_delay_modules;
+		break;
+	case SDRAM_DELAY_WRITE_DQS:
+		*rst_delay = write_rst_dqs_delay_modules;
+		*inc_delay = write_inc_dqs_delay_modules;
+		break;
+	case SDRAM_DELAY_WRITE:
+		*rst_delay = write_rst_delay_modules;
+		*inc_delay = write_inc_delay_modules;
+		break;
+#endif // defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
+	default:
+		break;
+	}
+}
+
+int sdram_get_delay(enum sdram_delay_kind kind, int module) {
+	int *shadow = sdram_delay_shadow(kind, module);
+	return shadow ? *shadow : 0;
+}
+
+/* Applies a reset (or else an increment) to a delay */
+static void sdram_delay_step(enum sdram_delay_kind kind, int module, int dq_line, int reset) {
+	modules_action_callback rst_delay, inc_delay;
+
+#if defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
+	if (kind == SDRAM_DELAY_CLOCK) {
+		if (reset)
+			sdram_rst_clock_delay();
+		else
+			sdram_inc_clock_delay();
+		return;
+	}
+#endif // defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
+
+	sdram_delay_modules_actions(kind, &rst_delay, &inc_delay);
+	sdram_leveling_action_modules(1 << module, dq_line, reset ? rst_delay : inc_delay);
+}
+
+/* Moves a delay from its shadow value, by resetting it only when that is shorter */
+static void sdram_delay_move(enum sdram_delay_kind kind, int module, int dq_line, int target) {
+	int steps;
+
+#ifdef SDRAM_DELAY_PER_DQ
+	/* Shadow values are kept per module, not per DQ line, so the line is always reset */
+	sdram_delay_step(kind, module, dq_line, 1);
+	steps = target;
+#else
+	int current = sdram_get_delay(kind, module);
+	steps = (target - current) & (SDRAM_PHY_DELAYS - 1);
+
+	if (1 + target <= steps) {
+		sdram_delay_step(kind, module, dq_line, 1);
+		steps = target;
+	}
+#endif // SDRAM_DELAY_PER_DQ
+
+	while (steps-- > 0)
+		sdram_delay_step(kind, module, dq_line, 0);
+}
+
+#if defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE) && defined(CSR_DDRPHY_WDLY_DQS_INC_COUNT_ADDR) && \
+	!defined(SDRAM_PHY_USDDRPHY) && !defined(SDRAM_PHY_USPDDRPHY)
+/* Checks the DQS delay of a module against the tap count of the PHY */
+static int sdram_delay_check_dqs(int module, int dq_line) {
+	int count;
+
+	sdram_select(module, dq_line);
+	count = ddrphy_wdly_dqs_inc_count_read() & (SDRAM_PHY_DELAYS - 1);
+	sdram_deselect(module, dq_line);
+
+	return count == write_dqs_delay[module];
+}
+#define SDRAM_DELAY_CHECK_DQS
+#endif
+
+int sdram_set_delay(enum sdram_delay_kind kind, int module, int dq_line, int target) {
+	target &= SDRAM_PHY_DELAYS - 1;
+
+#if defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
+	/* DQ and DQS no longer move together after write DQ-DQS training */
+	if (kind == SDRAM_DELAY_WRITE && write_dq_delay[module] != write_dqs_delay[module]) {
+		sdram_delay_move(SDRAM_DELAY_WRITE_DQ, module, dq_line, target);
+		kind = SDRAM_DELAY_WRITE_DQS;
+	}
+#endif // defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
+
+	sdram_delay_move(kind, module, dq_line, target);
+
+#ifdef SDRAM_DELAY_CHECK_DQS
+	if (kind == SDRAM_DELAY_WRITE || kind == SDRAM_DELAY_WRITE_DQS) {
+		if (sdram_delay_check_dqs(module, dq_line))
+			return 1;
+		/* Out of sync, start over from a reset */
+		printf("m%d: DQS delay does not match, resetting\n", module);
+		sdram_delay_step(kind, module, dq_line, 1);
+		sdram_delay_move(kind, module, dq_line, target);
+		return sdram_delay_check_dqs(module, dq_line);
+	}
+#endif // SDRAM_DELAY_CHECK_DQS
+
+	return 1;
+}
 #endif // defined(CSR_DDRPHY_DLY_SEL_ADDR)
 
 #ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
@@ -10,12 +10,16 @@ extern "C" {
 #include <generated/sdram_phy.h>
 
 typedef void (*action_callback)(int module);
+/* Action on a mask of modules, see sdram_leveling_action_modules() */
+typedef void (*modules_action_callback)(unsigned int modules);
 
 #if defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
 
 extern int read_dq_delay[SDRAM_PHY_MODULES];
 void read_inc_dq_delay(int module);
 void read_rst_dq_delay(int module);
+void read_inc_dq_delay_modules(unsigned int modules);
+void read_rst_dq_delay_modules(unsigned int modules);
 
 #endif // defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
 
@@ -26,6 +30,7 @@ void sdram_inc_clock_delay(void);
 void sdram_rst_clock_delay(void);
 
 extern int write_dq_delay[SDRAM_PHY_MODULES];
+extern int write_dqs_delay[SDRAM_PHY_MODULES];
 void write_inc_dq_delay(int module);
 void write_rst_dq_delay(int module);
 
@@ -35,6 +40,13 @@ void write_rst_dqs_delay(int module);
 void write_inc_delay(int module);
 void write_rst_delay(int module);
 
+void write_inc_dq_delay_modules(unsigned int modules);
+void write_rst_dq_delay_modules(unsigned int modules);
+void write_inc_dqs_delay_modules(unsigned int modules);
+void write_rst_dqs_delay_modules(unsigned int modules);
+void write_inc_delay_modules(unsigned int modules);
+void write_rst_delay_modules(unsigned int modules);
+
 #endif // defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE)
 
 #if defined(SDRAM_PHY_BITSLIPS)
@@ -42,10 +54,14 @@ void write_rst_delay(int module);
 extern int read_dq_bitslip[SDRAM_PHY_MODULES];
 void read_inc_dq_bitslip(int module);
 void read_rst_dq_bitslip(int module);
+void read_inc_dq_bitslip_modules(unsigned int modules);
+void read_rst_dq_bitslip_modules(unsigned int modules);
 
 extern int write_dq_bitslip[SDRAM_PHY_MODULES];
 void write_inc_dq_bitslip(int module);
 void write_rst_dq_bitslip(int module);
+void write_inc_dq_bitslip_modules(unsigned int modules);
+void write_rst_dq_bitslip_modules(unsigned int modules);
 
 #endif // defined(SDRAM_PHY_BITSLIPS)
 
@@ -53,6 +69,28 @@ void write_rst_dq_bitslip(int module);
 void sdram_select(int module, int dq_line);
 void sdram_deselect(int module, int dq_line);
 void sdram_leveling_action(int module, int dq_line, action_callback action);
+/* Selects all modules in the mask and steps them with a single action */
+void sdram_select_modules(unsigned int modules, int dq_line);
+void sdram_leveling_action_modules(unsigned int modules, int dq_line, modules_action_callback action);
+
+enum sdram_delay_kind {
+	SDRAM_DELAY_READ_DQ,
+	SDRAM_DELAY_WRITE_DQ,
+	SDRAM_DELAY_WRITE_DQS,
+	SDRAM_DELAY_WRITE,      /* DQ and DQS together, as in write leveling */
+	SDRAM_DELAY_CLOCK,      /* Module is ignored */
+};
+
+/* Mask actions resetting and incrementing a kind of delay */
+void sdram_delay_modules_actions(enum sdram_delay_kind kind,
+	modules_action_callback *rst_delay, modules_action_callback *inc_delay);
+int sdram_get_delay(enum sdram_delay_kind kind, int module);
+/*
+ * Moves a delay to the target tap from its current (shadow) value, going
+ * forward and wrapping around or through a reset, whichever takes fewer
+ * steps. Returns 0 when the PHY reads back a different DQS delay.
+ */
+int sdram_set_delay(enum sdram_delay_kind kind, int module, int dq_line, int target);
 #endif // defined(CSR_DDRPHY_DLY_SEL_ADDR)
 
 #ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
@@ -3,6 +3,7 @@
 #if defined(CSR_SDRAM_BASE) && defined(SDRAM_PHY_DDR5)
 #include <liblitedram/ddr5_helpers.h>
 
+#include <liblitedram/sdram_profile.h>
 #include <liblitedram/sdram_rcd.h>
 #include <liblitedram/sdram_spd.h>
 
@@ -2103,12 +2104,16 @@ void sdram_ddr5_flow(void) {
         }
         exit_ca_pass(0); // FIXME: handle multiple RCDs
         for (int channel = 0; channel < base_ctx->channels; ++channel) {
+            SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_DDR5_CS_CA_TRAINING);
             sdram_ddr5_cs_ca_training(base_ctx, channel);
+            SDRAM_PROFILE_END(SDRAM_PROFILE_DDR5_CS_CA_TRAINING);
         }
     } else {
         for (int rank = 0; rank < base_ctx->ranks; ++rank)
             setup_dram_mrs_sequence(rank);
+        SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_DDR5_CS_CA_TRAINING);
         sdram_ddr5_cs_ca_training(base_ctx, -1);
+        SDRAM_PROFILE_END(SDRAM_PROFILE_DDR5_CS_CA_TRAINING);
     }
 #ifndef KEEP_GOING_ON_DRAM_ERROR
     if(!base_ctx->CS_CA_successful)
@@ -2137,7 +2142,12 @@ void sdram_ddr5_flow(void) {
             send_mrw(channel, rank, MODULE_BROADCAST, 2, 0|use_internal_write_timing|single_cycle_MPC);
 
     for (int rank = 0; rank < base_ctx->ranks; ++rank) {
-        if(dram_enumerate(base_ctx, rank))
+        bool enumerated;
+
+        SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_DDR5_ENUMERATE);
+        enumerated = dram_enumerate(base_ctx, rank);
+        SDRAM_PROFILE_END(SDRAM_PROFILE_DDR5_ENUMERATE);
+        if(enumerated)
             continue;
 #ifndef KEEP_GOING_ON_DRAM_ERROR
         return;
@@ -2152,12 +2162,20 @@ void sdram_ddr5_flow(void) {
     }
 #endif // defined(CONFIG_HAS_I2C)
 
-    if (!sdram_ddr5_read_training(base_ctx)) {
+    bool trained;
+
+    SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_DDR5_READ_TRAINING);
+    trained = sdram_ddr5_read_training(base_ctx);
+    SDRAM_PROFILE_END(SDRAM_PROFILE_DDR5_READ_TRAINING);
+    if (!trained) {
 #ifndef KEEP_GOING_ON_DRAM_ERROR
         return;
 #endif // KEEP_GOING_ON_DRAM_ERROR
     }
-    if (!sdram_ddr5_write_training(base_ctx)) {
+    SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_DDR5_WRITE_TRAINING);
+    trained = sdram_ddr5_write_training(base_ctx);
+    SDRAM_PROFILE_END(SDRAM_PROFILE_DDR5_WRITE_TRAINING);
+    if (!trained) {
 #ifndef KEEP_GOING_ON_DRAM_ERROR
         return;
 #endif // KEEP_GOING_ON_DRAM_ERROR
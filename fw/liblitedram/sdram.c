@@ -13,8 +13,10 @@
 #ifdef CSR_SDRAM_BASE
 #include <generated/mem.h>
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <libbase/memtest.h>
 #include <libbase/lfsr.h>
@@ -23,10 +25,12 @@
 #include <generated/sdram_timings.h>
 
 #include <generated/mem.h>
+#include <generated/soc.h>
 #include <system.h>
 
 #include <liblitedram/sdram.h>
 #include <liblitedram/sdram_dbg.h>
+#include <liblitedram/sdram_profile.h>
 #include <liblitedram/sdram_spd.h>
 
 #ifdef SDRAM_PHY_DDR5
@@ -36,6 +40,8 @@
 #include <liblitedram/accessors.h>
 #endif // SDRAM_PHY_DDR5
 
+#include "sim_host.h"
+
 //#define SDRAM_TEST_DISABLE
 #define SDRAM_WRITE_LEVELING_CMD_DELAY_DEBUG
 #define SDRAM_WRITE_LATENCY_CALIBRATION_DEBUG
@@ -66,15 +72,105 @@
 #define max(x, y) (((x) > (y)) ? (x) : (y))
 #define min(x, y) (((x) < (y)) ? (x) : (y))
 
+/* Test pattern runs of the leveling, each evaluates a delay tap of all modules */
+int sdram_tap_evaluations;
+
+/*-----------------------------------------------------------------------*/
+/* Timing                                                                */
+/*-----------------------------------------------------------------------*/
+
+unsigned int sdram_wait_total;
+
+/*
+ * Nop loop of the generated init sequence, its counts are loop iterations
+ * rather than cycles. Everything else waits with sdram_wait().
+ */
 __attribute__((unused)) void cdelay(int i) {
 #ifndef CONFIG_BIOS_NO_DELAYS
+	unsigned int start = csrr(mcycle);
 	while(i > 0) {
 		__asm__ volatile(CONFIG_CPU_NOP);
 		i--;
 	}
+	sdram_wait_total += (unsigned int)csrr(mcycle) - start;
 #endif // CONFIG_BIOS_NO_DELAYS
 }
 
+/* Waits for a number of sys clock cycles, mcycle runs at the sys clock */
+void sdram_wait(unsigned int cycles) {
+#ifndef CONFIG_BIOS_NO_DELAYS
+	unsigned int start = csrr(mcycle);
+	unsigned int elapsed;
+	do {
+		elapsed = (unsigned int)csrr(mcycle) - start;
+	} while (elapsed < cycles);
+	sdram_wait_total += elapsed;
+#endif // CONFIG_BIOS_NO_DELAYS
+}
+
+void sdram_wait_ns(unsigned int ns) {
+	sdram_wait(SDRAM_NS_TO_CYCLES(ns));
+}
+
+/* sys clock cycles of a number of DRAM clock cycles (tCK), rounded up */
+#define SDRAM_TCK_TO_CYCLES(tck) (((tck) + SDRAM_PHY_PHASES - 1)/SDRAM_PHY_PHASES)
+
+/*
+ * Latency the PHY adds to the command and read data paths, in sys clock
+ * cycles. src/gen.py exports the read latency of the PHY settings, from the
+ * DFI read command to valid read data, which is this latency plus CL. The
+ * fallback of 8 is not derived from any PHY, override it for cores built
+ * without the export.
+ */
+#ifndef SDRAM_PHY_PIPELINE_CYCLES
+#if defined(SDRAM_PHY_READ_LATENCY) && defined(SDRAM_PHY_CL)
+#define SDRAM_PHY_PIPELINE_CYCLES (SDRAM_PHY_READ_LATENCY - SDRAM_TCK_TO_CYCLES(SDRAM_PHY_CL))
+#else
+#define SDRAM_PHY_PIPELINE_CYCLES 8
+#endif // defined(SDRAM_PHY_READ_LATENCY) && defined(SDRAM_PHY_CL)
+#endif // SDRAM_PHY_PIPELINE_CYCLES
+
+/*
+ * Waits after the commands issued through the DFI injector, in sys clock
+ * cycles. The controller timings are in sys clock cycles as well. A write
+ * lasts CWL and one cycle of data before tWTR (and tWR, for the precharge
+ * that follows the read) starts, read data is there CL, one cycle of data
+ * and the PHY latency after the command. PHYs that do not export CL or CWL
+ * keep the nop loop these waits replaced, see sdram_wait_write/read().
+ */
+#define SDRAM_WAIT_ACTIVATE  SDRAM_TIMINGS_DEFAULT_TRCD
+#define SDRAM_WAIT_PRECHARGE SDRAM_TIMINGS_DEFAULT_TRP
+#ifdef SDRAM_PHY_CWL
+#define SDRAM_WAIT_WRITE     (SDRAM_PHY_PIPELINE_CYCLES + SDRAM_TCK_TO_CYCLES(SDRAM_PHY_CWL) + 1 + \
+	max(SDRAM_TIMINGS_DEFAULT_TWTR, SDRAM_TIMINGS_DEFAULT_TWR))
+#endif // SDRAM_PHY_CWL
+#ifdef SDRAM_PHY_CL
+#define SDRAM_WAIT_READ      (SDRAM_PHY_PIPELINE_CYCLES + SDRAM_TCK_TO_CYCLES(SDRAM_PHY_CL) + 1)
+#endif // SDRAM_PHY_CL
+
+__attribute__((unused)) static void sdram_wait_write(void) {
+#ifdef SDRAM_WAIT_WRITE
+	sdram_wait(SDRAM_WAIT_WRITE);
+#else
+	cdelay(15);
+#endif // SDRAM_WAIT_WRITE
+}
+
+__attribute__((unused)) static void sdram_wait_read(void) {
+#ifdef SDRAM_WAIT_READ
+	sdram_wait(SDRAM_WAIT_READ);
+#else
+	cdelay(15);
+#endif // SDRAM_WAIT_READ
+}
+
+/* Write leveling: tWLMRD after enabling it, tWLO (at most 20ns) after a DQS strobe */
+#define SDRAM_WAIT_WLEVEL_ON     SDRAM_TCK_TO_CYCLES(40)
+#define SDRAM_WAIT_WLEVEL_STROBE (SDRAM_PHY_PIPELINE_CYCLES + SDRAM_NS_TO_CYCLES(20))
+
+/* Reset pulse of the PHY, a few cycles of its slowest clock */
+#define SDRAM_PHY_RESET_NS 1000
+
 /*-----------------------------------------------------------------------*/
 /* Constants                                                             */
 /*-----------------------------------------------------------------------*/
@@ -304,14 +400,14 @@ static void sdram_activate_test_row(void) {
 	sdram_dfii_pi0_address_write(0);
 	sdram_dfii_pi0_baddress_write(0);
 	command_p0(DFII_COMMAND_RAS|DFII_COMMAND_CS);
-	cdelay(15);
+	sdram_wait(SDRAM_WAIT_ACTIVATE);
 }
 
 static void sdram_precharge_test_row(void) {
 	sdram_dfii_pi0_address_write(0);
 	sdram_dfii_pi0_baddress_write(0);
 	command_p0(DFII_COMMAND_RAS|DFII_COMMAND_WE|DFII_COMMAND_CS);
-	cdelay(15);
+	sdram_wait(SDRAM_WAIT_PRECHARGE);
 }
 
 // Count number of bits in a 32-bit word, faster version than a while loop
@@ -325,56 +421,153 @@ static unsigned int popcount(unsigned int x) {
 	return x & 0x0000003F;
 }
 
-static void print_scan_errors(unsigned int errors) {
+// Character shown for a delay tap in the leveling scans
+static char scan_errors_char(unsigned int errors) {
 #ifdef SDRAM_LEVELING_SCAN_DISPLAY_HEX_DIV
 	// Display '.' for no errors, errors/div in hex if it is a single char, else show 'X'
 	errors = errors / SDRAM_LEVELING_SCAN_DISPLAY_HEX_DIV;
 	if (errors == 0)
-		printf(".");
+		return '.';
 	else if (errors > 0xf)
-		printf("X");
+		return 'X';
 	else
-		printf("%x", errors);
+		return "0123456789abcdef"[errors];
 #else
-		printf("%d", errors == 0);
+	return errors == 0 ? '1' : '0';
 #endif // SDRAM_LEVELING_SCAN_DISPLAY_HEX_DIV
 }
 
+/*
+ * All modules are scanned together, so the scan of every module is collected
+ * here and printed on its own line once the scan is done.
+ */
+#define SCAN_DISPLAY_LENGTH (2*SDRAM_PHY_DELAYS/MODULO + 2)
+
+static char _scan_display[SDRAM_PHY_MODULES][SCAN_DISPLAY_LENGTH];
+static int _scan_display_length[SDRAM_PHY_MODULES];
+
+static void scan_display_clear(void) {
+	int module;
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		_scan_display[module][0] = '\0';
+		_scan_display_length[module] = 0;
+	}
+}
+
+static void scan_display_add(int module, char c) {
+	int n = _scan_display_length[module];
+	if (n < SCAN_DISPLAY_LENGTH - 1) {
+		_scan_display[module][n++] = c;
+		_scan_display[module][n] = '\0';
+		_scan_display_length[module] = n;
+	}
+}
+
 #define READ_CHECK_TEST_PATTERN_MAX_ERRORS (8*SDRAM_PHY_PHASES*DFII_PIX_DATA_BYTES/SDRAM_PHY_MODULES)
 #define MODULE_BITMASK ((1<<SDRAM_PHY_DQ_DQS_RATIO)-1)
 
-static unsigned int sdram_write_read_check_test_pattern(int module, unsigned int seed, int dq_line) {
-	int p, i, bit;
-	unsigned int errors;
+#define DFII_PIX_DATA_WORDS ((DFII_PIX_DATA_BYTES + 3)/4)
+
+/* Data of a phase as written to the DFII, compared a word at a time */
+typedef union {
+	unsigned char bytes[4*DFII_PIX_DATA_WORDS];
+	unsigned int  words[DFII_PIX_DATA_WORDS];
+} sdram_pix_data_t;
+
+static int _seed_array[] = {42, 84, 36, 72, 24, 48};
+static int _seed_array_length = sizeof(_seed_array) / sizeof(_seed_array[0]);
+
+/* Pseudo-random sequences of all seeds */
+static sdram_pix_data_t _seed_patterns[sizeof(_seed_array) / sizeof(_seed_array[0])][SDRAM_PHY_PHASES];
+/* Data lines of every module (and DQ line) within the data of a phase */
+static sdram_pix_data_t _module_masks[SDRAM_PHY_MODULES][DQ_COUNT];
+static int _seed_patterns_ready;
+
+static void sdram_module_mask(int module, int dq_line, unsigned char *mask) {
+	int pebo;   // module's positive_edge_byte_offset
+	int nebo;   // module's negative_edge_byte_offset, could be undefined if SDR DRAM is used
+	int ibo;    // module's in byte offset (x4 ICs)
+	int bits;   // Check data lines
+
+	bits = MODULE_BITMASK;
+
+#ifdef SDRAM_DELAY_PER_DQ
+	bits = 1 << dq_line;
+#endif // SDRAM_DELAY_PER_DQ
+
+	/* Values written into CSR are Big Endian */
+	/* SDRAM_PHY_XDR is define 1 if SDR and 2 if DDR*/
+	nebo = (DFII_PIX_DATA_BYTES / SDRAM_PHY_XDR) - 1 - (module * SDRAM_PHY_DQ_DQS_RATIO)/8;
+	pebo = nebo + DFII_PIX_DATA_BYTES / SDRAM_PHY_XDR;
+	/* When DFII_PIX_DATA_BYTES is 1 and SDRAM_PHY_XDR is 2, pebo and nebo are both -1s,
+	* but only correct value is 0. This can happen when single x4 IC is used */
+	if ((DFII_PIX_DATA_BYTES/SDRAM_PHY_XDR) == 0) {
+		pebo = 0;
+		nebo = 0;
+	}
+
+	ibo = (module * SDRAM_PHY_DQ_DQS_RATIO)%8; // Non zero only if x4 ICs are used
+
+	mask[pebo] |= bits << ibo;
+	if (SDRAM_PHY_DQ_DQS_RATIO == 16)
+		mask[pebo+1] |= bits << ibo;
+
+#if SDRAM_PHY_XDR == 2
+	if (DFII_PIX_DATA_BYTES == 1) // Special case for x4 single IC
+		ibo = 0x4;
+	mask[nebo] |= bits << ibo;
+	if (SDRAM_PHY_DQ_DQS_RATIO == 16)
+		mask[nebo+1] |= bits << ibo;
+#endif // SDRAM_PHY_XDR == 2
+}
+
+static void sdram_generate_test_patterns(void) {
+	int s, p, i, bit, module, dq_line;
 	unsigned int prv;
 	unsigned char value;
-	unsigned char tst[DFII_PIX_DATA_BYTES];
-	unsigned char prs[SDRAM_PHY_PHASES][DFII_PIX_DATA_BYTES];
 
-	/* Generate pseudo-random sequence */
-	prv = seed;
-	for(p=0;p<SDRAM_PHY_PHASES;p++) {
-		for(i=0;i<DFII_PIX_DATA_BYTES;i++) {
-			value = 0;
-			for (bit=0;bit<8;bit++) {
-				prv = lfsr(32, prv);
-				value |= (prv&1) << bit;
+	for(s=0;s<_seed_array_length;s++) {
+		prv = _seed_array[s];
+		for(p=0;p<SDRAM_PHY_PHASES;p++) {
+			for(i=0;i<DFII_PIX_DATA_BYTES;i++) {
+				value = 0;
+				for (bit=0;bit<8;bit++) {
+					prv = lfsr(32, prv);
+					value |= (prv&1) << bit;
+				}
+				_seed_patterns[s][p].bytes[i] = value;
 			}
-			prs[p][i] = value;
 		}
 	}
 
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		for (dq_line = 0; dq_line < DQ_COUNT; dq_line++)
+			sdram_module_mask(module, dq_line, _module_masks[module][dq_line].bytes);
+
+	_seed_patterns_ready = 1;
+}
+
+/*
+ * Writes the test pattern of a seed and reads it back once for all modules,
+ * adding the bit errors of every module and DQ line to errors.
+ */
+static void sdram_write_read_check_test_pattern(int seed, unsigned int errors[SDRAM_PHY_MODULES][DQ_COUNT]) {
+	int p, w, module, dq_line;
+	unsigned int diff;
+	sdram_pix_data_t tst = {{0}};
+	const sdram_pix_data_t *prs = _seed_patterns[seed];
+
 	/* Activate */
 	sdram_activate_test_row();
 
 	/* Write pseudo-random sequence */
 	for(p=0;p<SDRAM_PHY_PHASES;p++) {
-		csr_wr_buf_uint8(sdram_dfii_pix_wrdata_addr(p), prs[p], DFII_PIX_DATA_BYTES);
+		csr_wr_buf_uint8(sdram_dfii_pix_wrdata_addr(p), prs[p].bytes, DFII_PIX_DATA_BYTES);
 	}
 	sdram_dfii_piwr_address_write(0);
 	sdram_dfii_piwr_baddress_write(0);
 	command_pwr(DFII_COMMAND_CAS|DFII_COMMAND_WE|DFII_COMMAND_CS|DFII_COMMAND_WRDATA);
-	cdelay(15);
+	sdram_wait_write();
 
 #if defined(SDRAM_PHY_ECP5DDRPHY) || defined(SDRAM_PHY_GW2DDRPHY)
 	ddrphy_burstdet_clr_write(1);
@@ -384,127 +577,173 @@ static unsigned int sdram_write_read_check_test_pattern(int module, unsigned int
 	sdram_dfii_pird_address_write(0);
 	sdram_dfii_pird_baddress_write(0);
 	command_prd(DFII_COMMAND_CAS|DFII_COMMAND_CS|DFII_COMMAND_RDDATA);
-	cdelay(15);
+	sdram_wait_read();
 
 	/* Precharge */
 	sdram_precharge_test_row();
 
-	errors = 0;
 	for(p=0;p<SDRAM_PHY_PHASES;p++) {
 		/* Read back test pattern */
-		csr_rd_buf_uint8(sdram_dfii_pix_rddata_addr(p), tst, DFII_PIX_DATA_BYTES);
-		/* Verify bytes matching current 'module' */
-		int pebo;   // module's positive_edge_byte_offset
-		int nebo;   // module's negative_edge_byte_offset, could be undefined if SDR DRAM is used
-		int ibo;    // module's in byte offset (x4 ICs)
-		int mask;   // Check data lines
+		csr_rd_buf_uint8(sdram_dfii_pix_rddata_addr(p), tst.bytes, DFII_PIX_DATA_BYTES);
+		/* Count the flipped bits of every module */
+		for (w = 0; w < DFII_PIX_DATA_WORDS; w++) {
+			diff = prs[p].words[w] ^ tst.words[w];
+			if (diff == 0)
+				continue;
+			for (module = 0; module < SDRAM_PHY_MODULES; module++)
+				for (dq_line = 0; dq_line < DQ_COUNT; dq_line++)
+					errors[module][dq_line] += popcount(diff & _module_masks[module][dq_line].words[w]);
+		}
+	}
 
-		mask = MODULE_BITMASK;
+#if defined(SDRAM_PHY_ECP5DDRPHY) || defined(SDRAM_PHY_GW2DDRPHY)
+	unsigned int seen = ddrphy_burstdet_seen_read();
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		if (((seen >> module) & 0x1) != 1)
+			for (dq_line = 0; dq_line < DQ_COUNT; dq_line++)
+				errors[module][dq_line] += 1;
+#endif // defined(SDRAM_PHY_ECP5DDRPHY) || defined(SDRAM_PHY_GW2DDRPHY)
+}
 
-#ifdef SDRAM_DELAY_PER_DQ
-		mask = 1 << dq_line;
-#endif // SDRAM_DELAY_PER_DQ
+/* Errors of all seeds, for every module and DQ line */
+static void run_test_pattern(unsigned int errors[SDRAM_PHY_MODULES][DQ_COUNT]) {
+	int module, dq_line;
+	if (!_seed_patterns_ready)
+		sdram_generate_test_patterns();
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		for (dq_line = 0; dq_line < DQ_COUNT; dq_line++)
+			errors[module][dq_line] = 0;
+	sdram_tap_evaluations++;
+	SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_TEST_PATTERN);
+	for (int i = 0; i < _seed_array_length; i++) {
+		sdram_write_read_check_test_pattern(i, errors);
+	}
+	SDRAM_PROFILE_END(SDRAM_PROFILE_TEST_PATTERN);
+}
 
-		/* Values written into CSR are Big Endian */
-		/* SDRAM_PHY_XDR is define 1 if SDR and 2 if DDR*/
-		nebo = (DFII_PIX_DATA_BYTES / SDRAM_PHY_XDR) - 1 - (module * SDRAM_PHY_DQ_DQS_RATIO)/8;
-		pebo = nebo + DFII_PIX_DATA_BYTES / SDRAM_PHY_XDR;
-		/* When DFII_PIX_DATA_BYTES is 1 and SDRAM_PHY_XDR is 2, pebo and nebo are both -1s,
-		* but only correct value is 0. This can happen when single x4 IC is used */
-		if ((DFII_PIX_DATA_BYTES/SDRAM_PHY_XDR) == 0) {
-			pebo = 0;
-			nebo = 0;
-		}
+#define ALL_MODULES ((1 << SDRAM_PHY_MODULES) - 1)
 
-		ibo = (module * SDRAM_PHY_DQ_DQS_RATIO)%8; // Non zero only if x4 ICs are used
+/* Pass/fail bitmap of the delay taps of a module */
+#define TAP_BITMAP_WORDS ((SDRAM_PHY_DELAYS + 31)/32)
 
-		errors += popcount(((prs[p][pebo] >> ibo) & mask) ^
-		                   ((tst[pebo] >> ibo) & mask));
-		if (SDRAM_PHY_DQ_DQS_RATIO == 16)
-			errors += popcount(((prs[p][pebo+1] >> ibo) & mask) ^
-			                   ((tst[pebo+1] >> ibo) & mask));
+static void tap_bitmap_clear(unsigned int *bitmap) {
+	int i;
+	for (i = 0; i < TAP_BITMAP_WORDS; i++)
+		bitmap[i] = 0;
+}
 
+static void tap_bitmap_set(unsigned int *bitmap, int tap) {
+	bitmap[tap/32] |= 1u << (tap%32);
+}
 
-#if SDRAM_PHY_XDR == 2
-		if (DFII_PIX_DATA_BYTES == 1) // Special case for x4 single IC
-			ibo = 0x4;
-		errors += popcount(((prs[p][nebo] >> ibo) & mask) ^
-		                   ((tst[nebo] >> ibo) & mask));
-		if (SDRAM_PHY_DQ_DQS_RATIO == 16)
-			errors += popcount(((prs[p][nebo+1] >> ibo) & mask) ^
-			                   ((tst[nebo+1] >> ibo) & mask));
-#endif // SDRAM_PHY_XDR == 2
-	}
+static int tap_bitmap_test(const unsigned int *bitmap, int tap) {
+	return (bitmap[tap/32] >> (tap%32)) & 1;
+}
 
-#if defined(SDRAM_PHY_ECP5DDRPHY) || defined(SDRAM_PHY_GW2DDRPHY)
-	if (((ddrphy_burstdet_seen_read() >> module) & 0x1) != 1)
-		errors += 1;
-#endif // defined(SDRAM_PHY_ECP5DDRPHY) || defined(SDRAM_PHY_GW2DDRPHY)
+/*
+ * Sweeps the delays of all modules through every tap in one pass, stepping
+ * them together, and records the taps that pass the test pattern in the
+ * bitmap of every module. With scores the errors are also accumulated into
+ * a score of the window of every module.
+ */
+static void sdram_leveling_scan_taps(int show, modules_action_callback rst_delay,
+	modules_action_callback inc_delay, int dq_line,
+	unsigned int pass[SDRAM_PHY_MODULES][TAP_BITMAP_WORDS], unsigned int *scores) {
+	const unsigned int max_errors = _seed_array_length*READ_CHECK_TEST_PATTERN_MAX_ERRORS;
+	unsigned int errors[SDRAM_PHY_MODULES][DQ_COUNT];
+	int module, delay;
+
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		tap_bitmap_clear(pass[module]);
+		if (scores)
+			scores[module] = 0;
+	}
 
-	return errors;
+	sdram_leveling_action_modules(ALL_MODULES, dq_line, rst_delay);
+	for (delay = 0; delay < SDRAM_PHY_DELAYS; delay++) {
+		run_test_pattern(errors);
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+			unsigned int module_errors = errors[module][dq_line];
+			int working = module_errors == 0;
+			if (working)
+				tap_bitmap_set(pass[module], delay);
+			/* When any scan is working then the final score will always be higher then if no scan was working */
+			if (scores)
+				scores[module] += (working * max_errors*SDRAM_PHY_DELAYS) + (max_errors - module_errors);
+			if (show && (delay%MODULO == 0))
+				scan_display_add(module, scan_errors_char(module_errors));
+		}
+		if (delay + 1 < SDRAM_PHY_DELAYS)
+			sdram_leveling_action_modules(ALL_MODULES, dq_line, inc_delay);
+	}
 }
 
-static int _seed_array[] = {42, 84, 36, 72, 24, 48};
-static int _seed_array_length = sizeof(_seed_array) / sizeof(_seed_array[0]);
+/*
+ * Moves the delays of the modules in the mask to their own targets. Delay
+ * lines only count up and wrap around, so each delay goes forward by the
+ * difference, or through a reset when that is shorter or its current value
+ * is unknown (negative). Modules that still have to count up are stepped
+ * together.
+ */
+static void sdram_leveling_set_delays(unsigned int modules, int dq_line,
+	modules_action_callback rst_delay, modules_action_callback inc_delay,
+	int *current, const int *target) {
+	unsigned int reset = 0, step;
+	int steps[SDRAM_PHY_MODULES];
+	int module;
 
-static int run_test_pattern(int module, int dq_line) {
-	int errors = 0;
-	for (int i = 0; i < _seed_array_length; i++) {
-		errors += sdram_write_read_check_test_pattern(module, _seed_array[i], dq_line);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		steps[module] = 0;
+		if (!(modules & (1 << module)))
+			continue;
+		steps[module] = (target[module] - current[module]) & (SDRAM_PHY_DELAYS - 1);
+		if (current[module] < 0 || 1 + target[module] < steps[module]) {
+			reset |= 1 << module;
+			steps[module] = target[module];
+		}
+		current[module] = target[module];
+	}
+	if (reset)
+		sdram_leveling_action_modules(reset, dq_line, rst_delay);
+
+	while (1) {
+		step = 0;
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+			if (steps[module] > 0) {
+				step |= 1 << module;
+				steps[module]--;
+			}
+		}
+		if (!step)
+			break;
+		sdram_leveling_action_modules(step, dq_line, inc_delay);
 	}
-	return errors;
 }
 
-static void sdram_leveling_center_module(
-	int module, int show_short, int show_long, action_callback rst_delay,
-	action_callback inc_delay, int dq_line) {
+#ifndef SDRAM_LEVELING_BINARY_SEARCH
 
-	int i;
-	int show;
+/* Finds the largest working delay window in the taps a module passed */
+static void sdram_leveling_find_window(const unsigned int *pass, int *window_min, int *window_max) {
 	int working, last_working;
-	unsigned int errors;
-	int delay, delay_mid, delay_range;
+	int delay;
 	int delay_min = -1, delay_max = -1, cur_delay_min = -1;
 
-	if (show_long)
-#ifdef SDRAM_DELAY_PER_DQ
-		printf("m%d dq_line:%d: |", module, dq_line);
-#else
-		printf("m%d: |", module);
-#endif // SDRAM_DELAY_PER_DQ
-
 	/* Find smallest working delay */
-	delay = 0;
 	working = 0;
-	sdram_leveling_action(module, dq_line, rst_delay);
-	while(1) {
-		errors = run_test_pattern(module, dq_line);
+	for (delay = 0; delay < SDRAM_PHY_DELAYS; delay++) {
 		last_working = working;
-		working = errors == 0;
-		show = show_long && (delay%MODULO == 0);
-		if (show)
-			print_scan_errors(errors);
-		if(working && last_working && delay_min < 0) {
+		working = tap_bitmap_test(pass, delay);
+		if (working && last_working) {
 			delay_min = delay - 1; // delay on edges can be spotty
 			break;
 		}
-		delay++;
-		if(delay >= SDRAM_PHY_DELAYS)
-			break;
-		sdram_leveling_action(module, dq_line, inc_delay);
 	}
 
 	delay_max = delay_min;
 	cur_delay_min = delay_min;
 	/* Find largest working delay range */
-	while(1) {
-		errors = run_test_pattern(module, dq_line);
-		working = errors == 0;
-		show = show_long && (delay%MODULO == 0);
-		if (show)
-			print_scan_errors(errors);
-
-		if (working) {
+	for (; delay < SDRAM_PHY_DELAYS; delay++) {
+		if (tap_bitmap_test(pass, delay)) {
 			int cur_delay_length = delay - cur_delay_min;
 			int best_delay_length = delay_max - delay_min;
 			if (cur_delay_length > best_delay_length) {
@@ -514,48 +753,232 @@ static void sdram_leveling_center_module(
 		} else {
 			cur_delay_min = delay + 1;
 		}
-		delay++;
-		if(delay >= SDRAM_PHY_DELAYS)
-			break;
-		sdram_leveling_action(module, dq_line, inc_delay);
 	}
 	if(delay_max < 0) {
-		delay_max = delay;
+		delay_max = SDRAM_PHY_DELAYS;
 	}
 
-	if (show_long)
-		printf("| ");
+	*window_min = delay_min;
+	*window_max = delay_max;
+}
 
-	delay_mid   = (delay_min+delay_max)/2 % SDRAM_PHY_DELAYS;
-	delay_range = (delay_max-delay_min)/2;
-	if (show_short) {
-		if (delay_min < 0)
-			printf("delays: -");
-		else
-			printf("delays: %02d+-%02d", delay_mid, delay_range);
+#else
+
+/* Coarse step of the window search, in taps */
+#ifndef SDRAM_LEVELING_COARSE_STEP
+#define SDRAM_LEVELING_COARSE_STEP max(SDRAM_PHY_DELAYS/8, 1)
+#endif // SDRAM_LEVELING_COARSE_STEP
+
+/*
+ * Tests every step-th tap of the modules in the mask and returns the longest
+ * run of working ones of each.
+ */
+static void sdram_leveling_scan_steps(unsigned int modules, int show_long,
+	modules_action_callback rst_delay, modules_action_callback inc_delay,
+	int dq_line, int *current, int step, int *best_min, int *best_max) {
+	unsigned int errors[SDRAM_PHY_MODULES][DQ_COUNT];
+	int target[SDRAM_PHY_MODULES];
+	int run_min[SDRAM_PHY_MODULES];
+	int module, delay;
+
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		if (!(modules & (1 << module)))
+			continue;
+		best_min[module] = -1;
+		best_max[module] = -1;
+		run_min[module] = -1;
 	}
+	for (delay = 0; delay < SDRAM_PHY_DELAYS; delay += step) {
+		for (module = 0; module < SDRAM_PHY_MODULES; module++)
+			target[module] = delay;
+		sdram_leveling_set_delays(modules, dq_line, rst_delay, inc_delay, current, target);
+		run_test_pattern(errors);
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+			if (!(modules & (1 << module)))
+				continue;
+			if (show_long && (delay%MODULO == 0))
+				scan_display_add(module, scan_errors_char(errors[module][dq_line]));
+			if (errors[module][dq_line] == 0) {
+				if (run_min[module] < 0)
+					run_min[module] = delay;
+				if (best_min[module] < 0 ||
+				    delay - run_min[module] > best_max[module] - best_min[module]) {
+					best_min[module] = run_min[module];
+					best_max[module] = delay;
+				}
+			} else {
+				run_min[module] = -1;
+			}
+		}
+	}
+}
 
-	if (show_long)
-		printf("\n");
+/*
+ * Moves every module towards the working/failing edge between good and bad,
+ * each module bisecting its own range, until the two are adjacent.
+ */
+static void sdram_leveling_bisect_edges(modules_action_callback rst_delay,
+	modules_action_callback inc_delay, int dq_line, int *current, int *good, int *bad) {
+	unsigned int errors[SDRAM_PHY_MODULES][DQ_COUNT];
+	int mid[SDRAM_PHY_MODULES];
+	unsigned int pending;
+	int module;
 
-	/* Set delay to the middle and check */
-	if (delay_min >= 0) {
-		int retries = 8; /* Do N configs/checks and give up if failing */
-		while (retries > 0) {
-			/* Set delay. */
-			sdram_leveling_action(module, dq_line, rst_delay);
-			cdelay(100);
-			for(i = 0; i < delay_mid; i++) {
-				sdram_leveling_action(module, dq_line, inc_delay);
-				cdelay(100);
+	while (1) {
+		pending = 0;
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+			if (good[module] - bad[module] > 1 || bad[module] - good[module] > 1) {
+				mid[module] = (good[module] + bad[module]) / 2;
+				pending |= 1 << module;
 			}
+		}
+		if (!pending)
+			break;
+		sdram_leveling_set_delays(pending, dq_line, rst_delay, inc_delay, current, mid);
+		run_test_pattern(errors);
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+			if (!(pending & (1 << module)))
+				continue;
+			if (errors[module][dq_line] == 0)
+				good[module] = mid[module];
+			else
+				bad[module] = mid[module];
+		}
+	}
+}
 
-			/* Check */
-			errors = run_test_pattern(module, dq_line);
-			if (errors == 0)
-				break;
-			retries--;
+/*
+ * Finds the largest working delay window of every module by testing every
+ * coarse step and locating both edges of the longest working run with a
+ * binary search between its outermost working step and the failing one next
+ * to it. Taps between the coarse steps of a window are assumed to work.
+ */
+static void sdram_leveling_search_window(
+	int show_long, modules_action_callback rst_delay, modules_action_callback inc_delay,
+	int dq_line, int *window_min, int *window_max) {
+
+	const int step = SDRAM_LEVELING_COARSE_STEP;
+	int current[SDRAM_PHY_MODULES];
+	int best_min[SDRAM_PHY_MODULES], best_max[SDRAM_PHY_MODULES];
+	int good[SDRAM_PHY_MODULES], bad[SDRAM_PHY_MODULES];
+	unsigned int missing;
+	int module;
+
+	/* Unknown delays, the first step resets them */
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		current[module] = -1;
+	sdram_leveling_scan_steps(ALL_MODULES, show_long, rst_delay, inc_delay,
+		dq_line, current, step, best_min, best_max);
+
+	/* No step works, the window may be narrower than a step */
+	missing = 0;
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		if (best_min[module] < 0)
+			missing |= 1 << module;
+	if (missing && step > 1) {
+		if (show_long)
+			for (module = 0; module < SDRAM_PHY_MODULES; module++)
+				if (missing & (1 << module))
+					scan_display_add(module, '|');
+		sdram_leveling_scan_steps(missing, show_long, rst_delay, inc_delay,
+			dq_line, current, 1, best_min, best_max);
+	}
+
+	/* Lower edges: good works, bad fails (or is outside of the line) */
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		good[module] = best_min[module];
+		bad[module] = best_min[module];
+		if (missing & (1 << module))
+			continue;
+		bad[module] = max(best_min[module] - step, -1);
+	}
+	sdram_leveling_bisect_edges(rst_delay, inc_delay, dq_line, current, good, bad);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		window_min[module] = good[module];
+
+	/* Upper edges */
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		good[module] = best_max[module];
+		bad[module] = best_max[module];
+		if (missing & (1 << module))
+			continue;
+		bad[module] = min(best_max[module] + step, SDRAM_PHY_DELAYS);
+	}
+	sdram_leveling_bisect_edges(rst_delay, inc_delay, dq_line, current, good, bad);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		window_max[module] = window_min[module] < 0 ? SDRAM_PHY_DELAYS : good[module];
+}
+
+#endif // SDRAM_LEVELING_BINARY_SEARCH
+
+static void print_leveling_window(int delay_min, int delay_max) {
+	if (delay_min < 0)
+		printf("delays: -");
+	else
+		printf("delays: %02d+-%02d", (delay_min+delay_max)/2 % SDRAM_PHY_DELAYS,
+			(delay_max-delay_min)/2);
+}
+
+/*
+ * Centers the delays of a kind of all modules in their working windows, which
+ * are returned in delay_min/delay_max (delay_min < 0 when none was found).
+ * With show_long the scan of every module is left in the scan display.
+ */
+static void sdram_leveling_center_modules(
+	int show_long, enum sdram_delay_kind kind,
+	int dq_line, int *delay_min, int *delay_max) {
+
+	int module;
+	unsigned int errors[SDRAM_PHY_MODULES][DQ_COUNT];
+	unsigned int pending;
+	int delay_mid[SDRAM_PHY_MODULES];
+	int current[SDRAM_PHY_MODULES];
+	modules_action_callback rst_delay, inc_delay;
+
+	sdram_delay_modules_actions(kind, &rst_delay, &inc_delay);
+
+	if (show_long)
+		scan_display_clear();
+
+#ifdef SDRAM_LEVELING_BINARY_SEARCH
+	sdram_leveling_search_window(show_long, rst_delay, inc_delay, dq_line,
+		delay_min, delay_max);
+#else
+	unsigned int pass[SDRAM_PHY_MODULES][TAP_BITMAP_WORDS];
+	sdram_leveling_scan_taps(show_long, rst_delay, inc_delay, dq_line, pass, NULL);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		sdram_leveling_find_window(pass[module], &delay_min[module], &delay_max[module]);
+#endif // SDRAM_LEVELING_BINARY_SEARCH
+
+	pending = 0;
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		delay_mid[module] = (delay_min[module]+delay_max[module])/2 % SDRAM_PHY_DELAYS;
+		if (delay_min[module] >= 0)
+			pending |= 1 << module;
+#ifdef SDRAM_DELAY_PER_DQ
+		/* Shadow values are kept per module, not per DQ line */
+		current[module] = -1;
+#else
+		current[module] = sdram_get_delay(kind, module);
+#endif // SDRAM_DELAY_PER_DQ
+	}
+
+	/* Set delays to the middle and check */
+	int retries = 8; /* Do N configs/checks and give up if failing */
+	while (pending && retries > 0) {
+		/* Move the delays from where the scan left them */
+		sdram_leveling_set_delays(pending, dq_line, rst_delay, inc_delay, current, delay_mid);
+		sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+
+		/* Check */
+		run_test_pattern(errors);
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+			if (errors[module][dq_line] == 0)
+				pending &= ~(1 << module);
+			/* Retry from a reset */
+			current[module] = -1;
 		}
+		retries--;
 	}
 }
 
@@ -597,21 +1020,19 @@ void sdram_write_leveling_rst_cmd_delay(int show) {
 }
 
 void sdram_write_leveling_force_cmd_delay(int taps, int show) {
-	int i;
 	_sdram_write_leveling_cmd_scan  = 0;
 	_sdram_write_leveling_cmd_delay = taps;
 	if (show)
 		printf("Forcing Cmd delay to %d taps\n", taps);
-	sdram_rst_clock_delay();
-	for (i=0; i<taps; i++) {
-		sdram_inc_clock_delay();
-	}
+	sdram_set_delay(SDRAM_DELAY_CLOCK, 0, 0, taps);
 }
 
 static int sdram_write_leveling_scan(int *delays, int loops, int show) {
 	int module, wdly, k, dq_line;
 
-	unsigned char taps_scan[SDRAM_PHY_DELAYS];
+	/* Taps at which every strobe was answered with ones, per module */
+	unsigned int taps_scan[SDRAM_PHY_MODULES][TAP_BITMAP_WORDS];
+	int zero_count[SDRAM_PHY_MODULES];
 
 	unsigned char all_modules_working[SDRAM_PHY_DELAYS];
 	for (wdly = 0; wdly < SDRAM_PHY_DELAYS; wdly++)
@@ -626,29 +1047,25 @@ static int sdram_write_leveling_scan(int *delays, int loops, int show) {
 	int ok;
 
 	sdram_write_leveling_on();
-	cdelay(100);
-	for(module = 0; module < SDRAM_PHY_MODULES; module++) {
-		for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
-			if (show)
-#ifdef SDRAM_DELAY_PER_DQ
-				printf("  m%d dq%d: |", module, dq_line);
-#else
-				printf("  m%d: |", module);
-#endif // SDRAM_DELAY_PER_DQ
-
-			/* Reset delay */
-			sdram_leveling_action(module, dq_line, write_rst_delay);
-			cdelay(100);
-
-			/* Scan write delay taps */
-			for(wdly=0;wdly<SDRAM_PHY_DELAYS;wdly++) {
-				int zero_count = 0;
-				int one_count = 0;
-				int show_iter = (wdly%MODULO == 0) && show;
-				for (k=0; k<loops; k++) {
-					ddrphy_wlevel_strobe_write(1);
-					cdelay(100);
-					csr_rd_buf_uint8(sdram_dfii_pix_rddata_addr(0), buf, DFII_PIX_DATA_BYTES);
+	sdram_wait(SDRAM_WAIT_WLEVEL_ON);
+	for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
+		/* Reset delays */
+		sdram_leveling_action_modules(ALL_MODULES, dq_line, write_rst_delay_modules);
+		sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+
+		/* Scan write delay taps of all modules at once, the feedback of
+		 * every module is in its own byte */
+		for(module = 0; module < SDRAM_PHY_MODULES; module++)
+			tap_bitmap_clear(taps_scan[module]);
+		for(wdly=0;wdly<SDRAM_PHY_DELAYS;wdly++) {
+			SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_WRITE_LEVELING_TAP);
+			for(module = 0; module < SDRAM_PHY_MODULES; module++)
+				zero_count[module] = 0;
+			for (k=0; k<loops; k++) {
+				ddrphy_wlevel_strobe_write(1);
+				sdram_wait(SDRAM_WAIT_WLEVEL_STROBE);
+				csr_rd_buf_uint8(sdram_dfii_pix_rddata_addr(0), buf, DFII_PIX_DATA_BYTES);
+				for(module = 0; module < SDRAM_PHY_MODULES; module++) {
 #if SDRAM_PHY_DQ_DQS_RATIO == 4
 					/* For x4 memories, we need to test individual nibbles, not bytes */
 
@@ -657,28 +1074,36 @@ static int sdram_write_leveling_scan(int *delays, int loops, int show) {
 					/* Shift the byte by 4 bits right if the module number is odd */
 					module_byte >>= 4 * (module % 2);
 					/* Extract the nibble from the tested module */
-					if ((module_byte & 0xf) != 0)
+					if ((module_byte & 0xf) == 0)
 #else // SDRAM_PHY_DQ_DQS_RATIO != 4
-					if (buf[SDRAM_PHY_MODULES-1-module] != 0)
+					if (buf[SDRAM_PHY_MODULES-1-module] == 0)
 #endif // SDRAM_PHY_DQ_DQS_RATIO == 4
-						one_count++;
-					else
-						zero_count++;
+						zero_count[module]++;
 				}
-				if (zero_count == 0)
-					taps_scan[wdly] = 1;
-				else
-					taps_scan[wdly] = 0;
+			}
+			for(module = 0; module < SDRAM_PHY_MODULES; module++) {
+				if (zero_count[module] == 0)
+					tap_bitmap_set(taps_scan[module], wdly);
+				all_modules_working[wdly] &= !!(zero_count[module] == 0);
+			}
 
-				all_modules_working[wdly] &= !!(zero_count == 0);
+			sdram_leveling_action_modules(ALL_MODULES, dq_line, write_inc_delay_modules);
+			sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+			SDRAM_PROFILE_END(SDRAM_PROFILE_WRITE_LEVELING_TAP);
+		}
 
-				if (show_iter)
-					printf("%d", taps_scan[wdly]);
-				sdram_leveling_action(module, dq_line, write_inc_delay);
-				cdelay(100);
-			}
-			if (show)
+		for(module = 0; module < SDRAM_PHY_MODULES; module++) {
+			if (show) {
+#ifdef SDRAM_DELAY_PER_DQ
+				printf("  m%d dq%d: |", module, dq_line);
+#else
+				printf("  m%d: |", module);
+#endif // SDRAM_DELAY_PER_DQ
+				for(wdly=0;wdly<SDRAM_PHY_DELAYS;wdly++)
+					if (wdly%MODULO == 0)
+						printf("%d", tap_bitmap_test(taps_scan[module], wdly));
 				printf("|");
+			}
 
 			/* Find longer 1 window and set delay at the 0/1 transition */
 			one_window_active = 0;
@@ -689,7 +1114,7 @@ static int sdram_write_leveling_scan(int *delays, int loops, int show) {
 			delays[module] = -1;
 			for(wdly=0;wdly<SDRAM_PHY_DELAYS+1;wdly++) {
 				if (one_window_active) {
-					if ((wdly == SDRAM_PHY_DELAYS) || (taps_scan[wdly] == 0)) {
+					if ((wdly == SDRAM_PHY_DELAYS) || !tap_bitmap_test(taps_scan[module], wdly)) {
 						one_window_active = 0;
 						one_window_count = wdly - one_window_start;
 						if (one_window_count > one_window_best_count) {
@@ -698,26 +1123,16 @@ static int sdram_write_leveling_scan(int *delays, int loops, int show) {
 						}
 					}
 				} else {
-					if (wdly != SDRAM_PHY_DELAYS && taps_scan[wdly]) {
+					if (wdly != SDRAM_PHY_DELAYS && tap_bitmap_test(taps_scan[module], wdly)) {
 						one_window_active = 1;
 						one_window_start = wdly;
 					}
 				}
 			}
 
-			/* Reset delay */
-			sdram_leveling_action(module, dq_line, write_rst_delay);
-			cdelay(100);
-
 			/* Use forced delay if configured */
 			if (_sdram_write_leveling_dat_delays[module] >= 0) {
 				delays[module] = _sdram_write_leveling_dat_delays[module];
-
-				/* Configure write delay */
-				for(wdly=0; wdly<delays[module]; wdly++)  {
-					sdram_leveling_action(module, dq_line, write_inc_delay);
-					cdelay(100);
-				}
 			/* Succeed only if the start of a 1s window has been found: */
 			} else if (
 				/* Start of 1s window directly seen after 0. */
@@ -730,13 +1145,11 @@ static int sdram_write_leveling_scan(int *delays, int loops, int show) {
 				one_window_start -= min(one_window_start, 16);
 #endif // SDRAM_PHY_DELAYS > 32
 				delays[module] = one_window_best_start;
-
-				/* Configure write delay */
-				for(wdly=0; wdly<delays[module]; wdly++) {
-					sdram_leveling_action(module, dq_line, write_inc_delay);
-					cdelay(100);
-				}
 			}
+
+			/* Configure write delay, from where the scan left it */
+			sdram_set_delay(SDRAM_DELAY_WRITE, module, dq_line, max(delays[module], 0));
+			sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
 			if (show) {
 				if (delays[module] == -1)
 					printf(" delay: -\n");
@@ -775,11 +1188,10 @@ static void sdram_write_leveling_find_cmd_delay(
 	int ok, module;
 
 	/* Scan through the range */
-	sdram_rst_clock_delay();
 	for (cdly = cdly_start; cdly < cdly_stop; cdly += cdly_step) {
-		/* Increment cdly to current value */
-		while (sdram_clock_delay < cdly)
-			sdram_inc_clock_delay();
+		SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_CMD_DELAY_SCAN);
+		/* Move cdly to current value */
+		sdram_set_delay(SDRAM_DELAY_CLOCK, 0, 0, cdly);
 
 		/* Write level using this delay */
 #ifdef SDRAM_WRITE_LEVELING_CMD_DELAY_DEBUG
@@ -818,6 +1230,7 @@ static void sdram_write_leveling_find_cmd_delay(
 #ifndef SDRAM_WRITE_LEVELING_CMD_DELAY_DEBUG
 		printf("%d", !!ok);
 #endif // SDRAM_WRITE_LEVELING_CMD_DELAY_DEBUG
+		SDRAM_PROFILE_END(SDRAM_PROFILE_CMD_DELAY_SCAN);
 	}
 }
 
@@ -837,6 +1250,9 @@ int sdram_write_leveling(void) {
 	_sdram_tck_taps = ddrphy_half_sys8x_taps_read()*4;
 	printf("  tCK equivalent taps: %d\n", _sdram_tck_taps);
 
+	/* The clock delay is moved from its shadow, which is only valid after a reset */
+	sdram_rst_clock_delay();
+
 	if (_sdram_write_leveling_cmd_scan) {
 		/* Center write leveling by varying cdly. Searching through all possible
 		 * values is slow, but we can use a simple optimization method of iterativly
@@ -900,12 +1316,8 @@ int sdram_write_leveling(void) {
 	best_cdly = best_cdly_win_start + best_cdly_win_len / 2;
 	printf("  Setting Cmd/Clk delay to %d taps.\n", best_cdly);
 	/* Set working or forced delay */
-	if (best_cdly >= 0) {
-		sdram_rst_clock_delay();
-		for (int i = 0; i < best_cdly; ++i) {
-			sdram_inc_clock_delay();
-		}
-	}
+	if (best_cdly >= 0)
+		sdram_set_delay(SDRAM_DELAY_CLOCK, 0, 0, best_cdly);
 
 	printf("  Data scan:\n");
 
@@ -923,88 +1335,93 @@ int sdram_write_leveling(void) {
 
 #if defined(SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE) || defined(SDRAM_PHY_WRITE_LATENCY_CALIBRATION_CAPABLE) || defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
 
-static unsigned int sdram_read_leveling_scan_module(int module, int bitslip, int show, int dq_line) {
-	const unsigned int max_errors = _seed_array_length*READ_CHECK_TEST_PATTERN_MAX_ERRORS;
-	int i;
-	unsigned int score;
-	unsigned int errors;
+/* Scores the read windows of all modules at the current bitslip */
+static void sdram_read_leveling_scan_modules(int show, int dq_line, unsigned int *scores) {
+	unsigned int pass[SDRAM_PHY_MODULES][TAP_BITMAP_WORDS];
 
 	/* Check test pattern for each delay value */
-	score = 0;
-	if (show)
-		printf("  m%d, b%02d: |", module, bitslip);
-	sdram_leveling_action(module, dq_line, read_rst_dq_delay);
-	for(i=0;i<SDRAM_PHY_DELAYS;i++) {
-		int working;
-		int _show = (i%MODULO == 0) & show;
-		errors = run_test_pattern(module, dq_line);
-		working = errors == 0;
-		/* When any scan is working then the final score will always be higher then if no scan was working */
-		score += (working * max_errors*SDRAM_PHY_DELAYS) + (max_errors - errors);
-		if (_show) {
-			print_scan_errors(errors);
-		}
-		sdram_leveling_action(module, dq_line, read_inc_dq_delay);
-	}
 	if (show)
-		printf("| ");
-
-	return score;
+		scan_display_clear();
+	sdram_leveling_scan_taps(show, read_rst_dq_delay_modules, read_inc_dq_delay_modules,
+		dq_line, pass, scores);
 }
 
 #endif // defined(SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE) || defined(SDRAM_PHY_WRITE_LATENCY_CALIBRATION_CAPABLE) || defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
 
-#ifdef SDRAM_PHY_READ_LEVELING_CAPABLE
+#if defined(SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE) || defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
 
-void sdram_read_leveling(void) {
+/* Selects the best read window of every module and centers its delay in it */
+static void sdram_read_leveling_best_bitslips(int show, int dq_line) {
 	int module;
 	int bitslip;
-	int dq_line;
-	unsigned int score;
-	unsigned int best_score;
-	int best_bitslip;
-
-	for(module=0; module<SDRAM_PHY_MODULES; module++) {
-		for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
-			/* Scan possible read windows */
-			best_score = 0;
-			best_bitslip = 0;
-			sdram_leveling_action(module, dq_line, read_rst_dq_bitslip);
-			for(bitslip=0; bitslip<SDRAM_PHY_BITSLIPS; bitslip++) {
-				/* Compute score */
-				score = sdram_read_leveling_scan_module(module, bitslip, 1, dq_line);
-				sdram_leveling_center_module(module, 1, 0,
-					read_rst_dq_delay, read_inc_dq_delay, dq_line);
+	unsigned int scores[SDRAM_PHY_MODULES];
+	unsigned int best_score[SDRAM_PHY_MODULES];
+	int best_bitslip[SDRAM_PHY_MODULES];
+	int delay_min[SDRAM_PHY_MODULES], delay_max[SDRAM_PHY_MODULES];
+
+	/* Scan possible read windows */
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		best_score[module] = 0;
+		best_bitslip[module] = 0;
+	}
+	sdram_leveling_action_modules(ALL_MODULES, dq_line, read_rst_dq_bitslip_modules);
+	for(bitslip=0; bitslip<SDRAM_PHY_BITSLIPS; bitslip++) {
+		/* Compute scores */
+		sdram_read_leveling_scan_modules(show, dq_line, scores);
+		sdram_leveling_center_modules(0, SDRAM_DELAY_READ_DQ,
+			dq_line, delay_min, delay_max);
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+			if (show) {
+				printf("  m%d, b%02d: |%s| ", module, bitslip, _scan_display[module]);
+				print_leveling_window(delay_min[module], delay_max[module]);
 				printf("\n");
-				if (score > best_score) {
-					best_bitslip = bitslip;
-					best_score = score;
-				}
-				/* Exit */
-				if (bitslip == SDRAM_PHY_BITSLIPS-1)
-					break;
-				/* Increment bitslip */
-				sdram_leveling_action(module, dq_line, read_inc_dq_bitslip);
 			}
+			if (scores[module] > best_score[module]) {
+				best_bitslip[module] = bitslip;
+				best_score[module] = scores[module];
+			}
+		}
+		/* Exit */
+		if (bitslip == SDRAM_PHY_BITSLIPS-1)
+			break;
+		/* Increment bitslip */
+		sdram_leveling_action_modules(ALL_MODULES, dq_line, read_inc_dq_bitslip_modules);
+	}
 
-			/* Select best read window */
+	/* Select best read windows */
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		sdram_leveling_action(module, dq_line, read_rst_dq_bitslip);
+		for (bitslip=0; bitslip<best_bitslip[module]; bitslip++)
+			sdram_leveling_action(module, dq_line, read_inc_dq_bitslip);
+	}
+
+	/* Re-do leveling on best read windows */
+	sdram_leveling_center_modules(0, SDRAM_DELAY_READ_DQ,
+		dq_line, delay_min, delay_max);
+	if (show) {
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
 #ifdef SDRAM_DELAY_PER_DQ
-			printf("  best: m%d, b%02d, dq_line%d ", module, best_bitslip, dq_line);
+			printf("  best: m%d, b%02d, dq_line%d ", module, best_bitslip[module], dq_line);
 #else
-			printf("  best: m%d, b%02d ", module, best_bitslip);
+			printf("  best: m%d, b%02d ", module, best_bitslip[module]);
 #endif // SDRAM_DELAY_PER_DQ
-			sdram_leveling_action(module, dq_line, read_rst_dq_bitslip);
-			for (bitslip=0; bitslip<best_bitslip; bitslip++)
-				sdram_leveling_action(module, dq_line, read_inc_dq_bitslip);
-
-			/* Re-do leveling on best read window*/
-			sdram_leveling_center_module(module, 1, 0,
-				read_rst_dq_delay, read_inc_dq_delay, dq_line);
+			print_leveling_window(delay_min[module], delay_max[module]);
 			printf("\n");
 		}
 	}
 }
 
+#endif // defined(SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE) || defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
+
+#ifdef SDRAM_PHY_READ_LEVELING_CAPABLE
+
+void sdram_read_leveling(void) {
+	int dq_line;
+
+	for (dq_line = 0; dq_line < DQ_COUNT; dq_line++)
+		sdram_read_leveling_best_bitslips(1, dq_line);
+}
+
 #endif // SDRAM_PHY_READ_LEVELING_CAPABLE
 
 #endif /* !defined(SDRAM_PHY_DDR5) && defined(CSR_DDRPHY_BASE) */
@@ -1020,52 +1437,59 @@ static void sdram_write_latency_calibration(void) {
 	int module;
 	int bitslip;
 	int dq_line;
-	unsigned int score;
-	unsigned int subscore;
-	unsigned int best_score;
-	int best_bitslip;
-
-	for(module = 0; module < SDRAM_PHY_MODULES; module++) {
-		for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
-			/* Scan possible write windows */
-			best_score   = 0;
-			best_bitslip = -1;
-			for(bitslip=0; bitslip<SDRAM_PHY_BITSLIPS; bitslip+=2) { /* +2 for tCK steps */
-				if (SDRAM_WLC_DEBUG)
-					printf("m%d wb%02d:\n", module, bitslip);
-
-				sdram_leveling_action(module, dq_line, write_rst_dq_bitslip);
-				for (i=0; i<bitslip; i++) {
-					sdram_leveling_action(module, dq_line, write_inc_dq_bitslip);
-				}
+	unsigned int score[SDRAM_PHY_MODULES];
+	unsigned int subscores[SDRAM_PHY_MODULES];
+	unsigned int best_score[SDRAM_PHY_MODULES];
+	int best_bitslip[SDRAM_PHY_MODULES];
+
+	for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
+		/* Scan possible write windows */
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+			best_score[module]   = 0;
+			best_bitslip[module] = -1;
+		}
+		for(bitslip=0; bitslip<SDRAM_PHY_BITSLIPS; bitslip+=2) { /* +2 for tCK steps */
+			if (SDRAM_WLC_DEBUG)
+				printf("wb%02d:\n", bitslip);
 
-				score = 0;
-				sdram_leveling_action(module, dq_line, read_rst_dq_bitslip);
+			sdram_leveling_action_modules(ALL_MODULES, dq_line, write_rst_dq_bitslip_modules);
+			for (i=0; i<bitslip; i++) {
+				sdram_leveling_action_modules(ALL_MODULES, dq_line, write_inc_dq_bitslip_modules);
+			}
+
+			for (module = 0; module < SDRAM_PHY_MODULES; module++)
+				score[module] = 0;
+			sdram_leveling_action_modules(ALL_MODULES, dq_line, read_rst_dq_bitslip_modules);
 
-				for(i=0; i<SDRAM_PHY_BITSLIPS; i++) {
-					/* Compute score */
-					const int debug = SDRAM_WLC_DEBUG; // Local variable should be optimized out
-					subscore = sdram_read_leveling_scan_module(module, i, debug, dq_line);
+			for(i=0; i<SDRAM_PHY_BITSLIPS; i++) {
+				/* Compute scores */
+				const int debug = SDRAM_WLC_DEBUG; // Local variable should be optimized out
+				sdram_read_leveling_scan_modules(debug, dq_line, subscores);
+				for (module = 0; module < SDRAM_PHY_MODULES; module++) {
 					// If SDRAM_WRITE_LATENCY_CALIBRATION_DEBUG was not defined, SDRAM_WLC_DEBUG will be defined as 0, so if(0) should be optimized out
 					if (debug)
-						printf("\n");
-					score = subscore > score ? subscore : score;
-					/* Increment bitslip */
-					sdram_leveling_action(module, dq_line, read_inc_dq_bitslip);
+						printf("  m%d, b%02d: |%s| \n", module, i, _scan_display[module]);
+					score[module] = subscores[module] > score[module] ? subscores[module] : score[module];
 				}
-				if (score > best_score) {
-					best_bitslip = bitslip;
-					best_score = score;
+				/* Increment bitslip */
+				sdram_leveling_action_modules(ALL_MODULES, dq_line, read_inc_dq_bitslip_modules);
+			}
+			for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+				if (score[module] > best_score[module]) {
+					best_bitslip[module] = bitslip;
+					best_score[module] = score[module];
 				}
 			}
+		}
 
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
 #ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
 			if (_sdram_write_leveling_bitslips[module] < 0)
-				bitslip = best_bitslip;
+				bitslip = best_bitslip[module];
 			else
 				bitslip = _sdram_write_leveling_bitslips[module];
 #else
-			bitslip = best_bitslip;
+			bitslip = best_bitslip[module];
 #endif // SDRAM_PHY_WRITE_LEVELING_CAPABLE
 			if (bitslip == -1)
 				printf("m%d:- ", module);
@@ -1097,45 +1521,25 @@ static void sdram_write_latency_calibration(void) {
 
 #ifdef SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE
 
-static void sdram_read_leveling_best_bitslip(int module, int dq_line) {
-	unsigned int score;
-	int bitslip;
-	int best_bitslip = 0;
-	unsigned int best_score = 0;
-
-	sdram_leveling_action(module, dq_line, read_rst_dq_bitslip);
-	for(bitslip=0; bitslip<SDRAM_PHY_BITSLIPS; bitslip++) {
-		score = sdram_read_leveling_scan_module(module, bitslip, 0, dq_line);
-		sdram_leveling_center_module(module, 0, 0,
-			read_rst_dq_delay, read_inc_dq_delay, dq_line);
-		if (score > best_score) {
-			best_bitslip = bitslip;
-			best_score = score;
-		}
-		if (bitslip == SDRAM_PHY_BITSLIPS-1)
-			break;
-		sdram_leveling_action(module, dq_line, read_inc_dq_bitslip);
-	}
-
-	/* Select best read window and re-center it */
-	sdram_leveling_action(module, dq_line, read_rst_dq_bitslip);
-	for (bitslip=0; bitslip<best_bitslip; bitslip++)
-		sdram_leveling_action(module, dq_line, read_inc_dq_bitslip);
-	sdram_leveling_center_module(module, 0, 0,
-		read_rst_dq_delay, read_inc_dq_delay, dq_line);
-}
-
 static void sdram_write_dq_dqs_training(void) {
 	int module;
 	int dq_line;
-
-	for(module=0; module<SDRAM_PHY_MODULES; module++) {
-		for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
-			/* Find best bitslip */
-			sdram_read_leveling_best_bitslip(module, dq_line);
-			/* Center DQ-DQS window */
-			sdram_leveling_center_module(module, 1, 1,
-				write_rst_dq_delay, write_inc_dq_delay, dq_line);
+	int delay_min[SDRAM_PHY_MODULES], delay_max[SDRAM_PHY_MODULES];
+
+	for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
+		/* Find best bitslips */
+		sdram_read_leveling_best_bitslips(0, dq_line);
+		/* Center DQ-DQS windows */
+		sdram_leveling_center_modules(1, SDRAM_DELAY_WRITE_DQ,
+			dq_line, delay_min, delay_max);
+		for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+#ifdef SDRAM_DELAY_PER_DQ
+			printf("m%d dq_line:%d: |%s| ", module, dq_line, _scan_display[module]);
+#else
+			printf("m%d: |%s| ", module, _scan_display[module]);
+#endif // SDRAM_DELAY_PER_DQ
+			print_leveling_window(delay_min[module], delay_max[module]);
+			printf("\n");
 		}
 	}
 }
@@ -1146,59 +1550,335 @@ static void sdram_write_dq_dqs_training(void) {
 /* Leveling                                                              */
 /*-----------------------------------------------------------------------*/
 
-int sdram_leveling(void) {
-	int module;
+/* Resets the delays and bitslips of all modules and DQ lines */
+static void sdram_leveling_reset(void) {
 	int dq_line;
-	sdram_software_control_on();
 
-	for(module=0; module<SDRAM_PHY_MODULES; module++) {
-		for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
+	for (dq_line = 0; dq_line < DQ_COUNT; dq_line++) {
 #ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
-			sdram_leveling_action(module, dq_line, write_rst_delay);
+		sdram_leveling_action_modules(ALL_MODULES, dq_line, write_rst_delay_modules);
 #ifdef SDRAM_PHY_BITSLIPS
-			sdram_leveling_action(module, dq_line, write_rst_dq_bitslip);
+		sdram_leveling_action_modules(ALL_MODULES, dq_line, write_rst_dq_bitslip_modules);
 #endif // SDRAM_PHY_BITSLIPS
 #endif // SDRAM_PHY_WRITE_LEVELING_CAPABLE
 
 #ifdef SDRAM_PHY_READ_LEVELING_CAPABLE
-			sdram_leveling_action(module, dq_line, read_rst_dq_delay);
+		sdram_leveling_action_modules(ALL_MODULES, dq_line, read_rst_dq_delay_modules);
 #ifdef SDRAM_PHY_BITSLIPS
-			sdram_leveling_action(module, dq_line, read_rst_dq_bitslip);
+		sdram_leveling_action_modules(ALL_MODULES, dq_line, read_rst_dq_bitslip_modules);
 #endif // SDRAM_PHY_BITSLIPS
 #endif // SDRAM_PHY_READ_LEVELING_CAPABLE
-		}
 	}
+}
+
+int sdram_leveling(void) {
+	unsigned int start = csrr(mcycle);
+	unsigned int wait_start = sdram_wait_total;
+	SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_LEVELING);
+	sdram_software_control_on();
+	sdram_tap_evaluations = 0;
+
+	sdram_leveling_reset();
 
 #ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
 	printf("Write leveling:\n");
+	sim_mark(2, "write leveling");
+	SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_WRITE_LEVELING);
 	sdram_write_leveling();
+	SDRAM_PROFILE_END(SDRAM_PROFILE_WRITE_LEVELING);
 #endif // SDRAM_PHY_WRITE_LEVELING_CAPABLE
 
 #ifdef SDRAM_PHY_WRITE_LATENCY_CALIBRATION_CAPABLE
 	printf("Write latency calibration:\n");
+	sim_mark(3, "write latency calibration");
+	SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_WRITE_LATENCY_CALIBRATION);
 	sdram_write_latency_calibration();
+	SDRAM_PROFILE_END(SDRAM_PROFILE_WRITE_LATENCY_CALIBRATION);
 #endif // SDRAM_PHY_WRITE_LATENCY_CALIBRATION_CAPABLE
 
 #ifdef SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE
 	printf("Write DQ-DQS training:\n");
+	sim_mark(4, "write dq-dqs training");
+	SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_WRITE_DQ_DQS_TRAINING);
 	sdram_write_dq_dqs_training();
+	SDRAM_PROFILE_END(SDRAM_PROFILE_WRITE_DQ_DQS_TRAINING);
 #endif // SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE
 
 #ifdef SDRAM_PHY_READ_LEVELING_CAPABLE
 	printf("Read leveling:\n");
+	sim_mark(5, "read leveling");
+	SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_READ_LEVELING);
 	sdram_read_leveling();
+	SDRAM_PROFILE_END(SDRAM_PROFILE_READ_LEVELING);
 #endif // SDRAM_PHY_READ_LEVELING_CAPABLE
 
+	sim_mark(7, "post training");
 	sdram_software_control_off();
+	SDRAM_PROFILE_END(SDRAM_PROFILE_LEVELING);
+
+#ifdef SDRAM_LEVELING_BINARY_SEARCH
+	printf("Leveling (binary search): ");
+#else
+	printf("Leveling (scan): ");
+#endif // SDRAM_LEVELING_BINARY_SEARCH
+	printf("%d tap evaluations, %u cycles (%u waiting)\n", sdram_tap_evaluations,
+		(unsigned int)csrr(mcycle) - start, sdram_wait_total - wait_start);
 
 	return 1;
 }
 
+/*-----------------------------------------------------------------------*/
+/* Training Results                                                      */
+/*-----------------------------------------------------------------------*/
+
+#if defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE) || defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
+
+_Static_assert(SDRAM_PHY_MODULES <= SDRAM_TRAINING_MODULES,
+	"struct sdram_training_s has no room for all modules");
+
+static uint32_t sdram_training_checksum(const struct sdram_training_s *training) {
+	const uint32_t *words = (const uint32_t *)training;
+	uint32_t sum = 0x5d4a3c2b; /* A cleared record is not valid */
+	unsigned int i;
+
+	for (i = 0; i < offsetof(struct sdram_training_s, checksum)/sizeof(uint32_t); i++)
+		sum = ((sum << 5) | (sum >> 27)) ^ words[i];
+	return sum;
+}
+
+void sdram_training_save(struct sdram_training_s *training) {
+	int module;
+
+	memset(training, 0, sizeof(*training));
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+#ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
+		training->write_dq_delay[module] = write_dq_delay[module];
+		training->write_dqs_delay[module] = write_dqs_delay[module];
+		training->write_dq_bitslip[module] = write_dq_bitslip[module];
+#endif // SDRAM_PHY_WRITE_LEVELING_CAPABLE
+#ifdef SDRAM_PHY_READ_LEVELING_CAPABLE
+		training->read_dq_delay[module] = read_dq_delay[module];
+		training->read_dq_bitslip[module] = read_dq_bitslip[module];
+#endif // SDRAM_PHY_READ_LEVELING_CAPABLE
+	}
+#ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
+	training->clock_delay = sdram_clock_delay;
+#endif // SDRAM_PHY_WRITE_LEVELING_CAPABLE
+	training->checksum = sdram_training_checksum(training);
+}
+
+/*
+ * Programs the PHY with the training results of an earlier leveling and
+ * checks them with one run of the test pattern. Returns 0 when the record is
+ * not valid or the test pattern fails, the leveling has to be run then.
+ */
+int sdram_training_restore(const struct sdram_training_s *training) {
+	unsigned int errors[SDRAM_PHY_MODULES][DQ_COUNT];
+	int module, i, ok;
+
+	if (training->checksum != sdram_training_checksum(training))
+		return 0;
+#ifdef SDRAM_DELAY_PER_DQ
+	/* The record keeps one delay per module */
+	return 0;
+#endif // SDRAM_DELAY_PER_DQ
+
+	printf("Restoring training results:\n");
+	sim_mark(6, "training restore");
+	SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_TRAINING_RESTORE);
+	sdram_software_control_on();
+
+	/* Set everything from a reset, the PHY reset may have cleared the taps */
+	sdram_leveling_reset();
+	ok = 1;
+#ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
+	sdram_rst_clock_delay();
+	ok &= sdram_set_delay(SDRAM_DELAY_CLOCK, 0, 0, training->clock_delay);
+#endif // SDRAM_PHY_WRITE_LEVELING_CAPABLE
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+#ifdef SDRAM_PHY_WRITE_LEVELING_CAPABLE
+		ok &= sdram_set_delay(SDRAM_DELAY_WRITE_DQS, module, 0, training->write_dqs_delay[module]);
+		ok &= sdram_set_delay(SDRAM_DELAY_WRITE_DQ, module, 0, training->write_dq_delay[module]);
+#ifdef SDRAM_PHY_BITSLIPS
+		for (i = 0; i < training->write_dq_bitslip[module]; i++)
+			sdram_leveling_action(module, 0, write_inc_dq_bitslip);
+#endif // SDRAM_PHY_BITSLIPS
+#endif // SDRAM_PHY_WRITE_LEVELING_CAPABLE
+#ifdef SDRAM_PHY_READ_LEVELING_CAPABLE
+		ok &= sdram_set_delay(SDRAM_DELAY_READ_DQ, module, 0, training->read_dq_delay[module]);
+#ifdef SDRAM_PHY_BITSLIPS
+		for (i = 0; i < training->read_dq_bitslip[module]; i++)
+			sdram_leveling_action(module, 0, read_inc_dq_bitslip);
+#endif // SDRAM_PHY_BITSLIPS
+#endif // SDRAM_PHY_READ_LEVELING_CAPABLE
+	}
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+
+	/* Check */
+	run_test_pattern(errors);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		if (errors[module][0] != 0)
+			ok = 0;
+
+	sdram_software_control_off();
+	SDRAM_PROFILE_END(SDRAM_PROFILE_TRAINING_RESTORE);
+	sim_mark(7, "post training");
+	if (!ok)
+		printf("Training results do not work, leveling\n");
+	return ok;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Drift Tracking                                                        */
+/*-----------------------------------------------------------------------*/
+
+/* Data of the test row the test pattern overwrites */
+static sdram_pix_data_t _test_row_data[SDRAM_PHY_PHASES];
+
+static void sdram_test_row_save(void) {
+	int p;
+
+	sdram_activate_test_row();
+	sdram_dfii_pird_address_write(0);
+	sdram_dfii_pird_baddress_write(0);
+	command_prd(DFII_COMMAND_CAS|DFII_COMMAND_CS|DFII_COMMAND_RDDATA);
+	sdram_wait_read();
+	sdram_precharge_test_row();
+	for (p = 0; p < SDRAM_PHY_PHASES; p++)
+		csr_rd_buf_uint8(sdram_dfii_pix_rddata_addr(p), _test_row_data[p].bytes, DFII_PIX_DATA_BYTES);
+}
+
+static void sdram_test_row_restore(void) {
+	int p;
+
+	sdram_activate_test_row();
+	for (p = 0; p < SDRAM_PHY_PHASES; p++)
+		csr_wr_buf_uint8(sdram_dfii_pix_wrdata_addr(p), _test_row_data[p].bytes, DFII_PIX_DATA_BYTES);
+	sdram_dfii_piwr_address_write(0);
+	sdram_dfii_piwr_baddress_write(0);
+	command_pwr(DFII_COMMAND_CAS|DFII_COMMAND_WE|DFII_COMMAND_CS|DFII_COMMAND_WRDATA);
+	sdram_wait_write();
+	sdram_precharge_test_row();
+}
+
+/*
+ * Tests the taps margin below and above the current delay of every module
+ * and moves the delay by one tap away from an edge that has come closer.
+ * Returns the mask of modules that moved.
+ */
+static unsigned int sdram_track_drift_delays(enum sdram_delay_kind kind, int margin) {
+	unsigned int errors[SDRAM_PHY_MODULES][DQ_COUNT];
+	int center[SDRAM_PHY_MODULES], current[SDRAM_PHY_MODULES], target[SDRAM_PHY_MODULES];
+	unsigned int early = 0, late = 0, moved = 0;
+	modules_action_callback rst_delay, inc_delay;
+	int module;
+
+	sdram_delay_modules_actions(kind, &rst_delay, &inc_delay);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		center[module] = current[module] = sdram_get_delay(kind, module);
+
+	/* Lower edge */
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		target[module] = max(center[module] - margin, 0);
+	sdram_leveling_set_delays(ALL_MODULES, 0, rst_delay, inc_delay, current, target);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+	run_test_pattern(errors);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		if (errors[module][0] != 0)
+			early |= 1 << module;
+
+	/* Upper edge */
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		target[module] = min(center[module] + margin, SDRAM_PHY_DELAYS - 1);
+	sdram_leveling_set_delays(ALL_MODULES, 0, rst_delay, inc_delay, current, target);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+	run_test_pattern(errors);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++)
+		if (errors[module][0] != 0)
+			late |= 1 << module;
+
+	/* Step away from the failing edge, when only one of them fails */
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		target[module] = center[module];
+		if (!((early ^ late) & (1 << module)))
+			continue;
+		if (early & (1 << module))
+			target[module] = min(center[module] + 1, SDRAM_PHY_DELAYS - 1);
+		else
+			target[module] = max(center[module] - 1, 0);
+		if (target[module] != center[module])
+			moved |= 1 << module;
+	}
+	sdram_leveling_set_delays(ALL_MODULES, 0, rst_delay, inc_delay, current, target);
+	sdram_wait(SDRAM_DELAY_SETTLE_CYCLES);
+
+	return moved;
+}
+
+/*
+ * Re-centers the read and write DQ delays of a trained SDRAM by probing the
+ * taps margin away from them, one tap per call. The DFII is taken over for
+ * the duration, the data at the test row is kept. Returns the number of
+ * delays moved.
+ */
+int sdram_track_drift(int margin) {
+	unsigned int control, moved;
+	int module, count = 0;
+
+#ifdef SDRAM_DELAY_PER_DQ
+	/* Only one delay per module is tracked */
+	return 0;
+#endif // SDRAM_DELAY_PER_DQ
+
+	control = sdram_dfii_control_read();
+	sdram_dfii_control_write(DFII_CONTROL_SOFTWARE);
+	sdram_test_row_save();
+
+#ifdef SDRAM_PHY_READ_LEVELING_CAPABLE
+	moved = sdram_track_drift_delays(SDRAM_DELAY_READ_DQ, margin);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		if (moved & (1 << module)) {
+			printf("m%d: rdly %d\n", module, read_dq_delay[module]);
+			count++;
+		}
+	}
+#endif // SDRAM_PHY_READ_LEVELING_CAPABLE
+
+#ifdef SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE
+	moved = sdram_track_drift_delays(SDRAM_DELAY_WRITE_DQ, margin);
+	for (module = 0; module < SDRAM_PHY_MODULES; module++) {
+		if (moved & (1 << module)) {
+			printf("m%d: wdly %d\n", module, write_dq_delay[module]);
+			count++;
+		}
+	}
+#endif // SDRAM_PHY_WRITE_DQ_DQS_TRAINING_CAPABLE
+
+	sdram_test_row_restore();
+	sdram_dfii_control_write(control);
+
+	return count;
+}
+
+#endif // defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE) || defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
+
 /*-----------------------------------------------------------------------*/
 /* Initialization                                                        */
 /*-----------------------------------------------------------------------*/
 
 int sdram_init(void) {
+	return sdram_init_training(NULL);
+}
+
+/*
+ * Initializes the SDRAM like sdram_init(), with the leveling replaced by the
+ * training results in the record when they still work. The record is updated
+ * after a leveling, so it can be kept for the next initialization.
+ */
+int sdram_init_training(struct sdram_training_s *training) {
+	sdram_profile_reset();
+	SDRAM_PROFILE_BEGIN(SDRAM_PROFILE_INIT);
+
 	/* Set timings (from SPD, if available) */
 	sdram_timings_init();
 #if defined(SDRAM_PHY_DDR4) && defined(CONFIG_HAS_I2C)
@@ -1233,9 +1913,9 @@ int sdram_init(void) {
 	sdram_software_control_on();
 #if CSR_DDRPHY_RST_ADDR
 	ddrphy_rst_write(1);
-	cdelay(1000);
+	sdram_wait_ns(SDRAM_PHY_RESET_NS);
 	ddrphy_rst_write(0);
-	cdelay(1000);
+	sdram_wait_ns(SDRAM_PHY_RESET_NS);
 #endif // CSR_DDRPHY_RST_ADDR
 
 #ifdef CSR_DDRCTRL_BASE
@@ -1248,7 +1928,11 @@ int sdram_init(void) {
 	reset_sequence();
 	init_sequence();
 #if defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE) || defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
-	sdram_leveling();
+	if (training == NULL || !sdram_training_restore(training)) {
+		sdram_leveling();
+		if (training != NULL)
+			sdram_training_save(training);
+	}
 #endif // defined(SDRAM_PHY_WRITE_LEVELING_CAPABLE) || defined(SDRAM_PHY_READ_LEVELING_CAPABLE)
 #endif /* SDRAM_PHY_DDR5 */
 	sdram_software_control_off();
@@ -1287,6 +1971,9 @@ int sdram_init(void) {
 #endif // SDRAM_PHY_READ_LEVELING_CAPABLE
 #endif /* not SDRAM_PHY_DDR5 */
 
+	SDRAM_PROFILE_END(SDRAM_PROFILE_INIT);
+	sdram_profile_print();
+
 #ifndef SDRAM_TEST_DISABLE
 	if(!memtest((unsigned int *) MAIN_RAM_BASE, MEMTEST_DATA_SIZE)) {
 #ifdef CSR_DDRCTRL_BASE
@@ -26,6 +26,23 @@ struct sdram_timings_s {
     uint32_t tzqcs;
 };
 
+/*-----------------------------------------------------------------------*/
+/* Timing                                                                */
+/*-----------------------------------------------------------------------*/
+/* sys clock cycles of a time in ns, rounded up */
+#define SDRAM_NS_TO_CYCLES(ns) \
+	(((ns)*((CONFIG_CLOCK_FREQUENCY + 999999)/1000000) + 999)/1000)
+
+/* Time for a delay or bitslip CSR write to reach the PHY, in sys clock cycles */
+#ifndef SDRAM_DELAY_SETTLE_CYCLES
+#define SDRAM_DELAY_SETTLE_CYCLES 4
+#endif // SDRAM_DELAY_SETTLE_CYCLES
+
+void sdram_wait(unsigned int cycles);
+void sdram_wait_ns(unsigned int ns);
+/* sys clock cycles spent in sdram_wait() and cdelay() */
+extern unsigned int sdram_wait_total;
+
 /*-----------------------------------------------------------------------*/
 /* Constants                                                             */
 /*-----------------------------------------------------------------------*/
@@ -61,11 +78,41 @@ void sdram_read_leveling(void);
 /* Leveling                                                              */
 /*-----------------------------------------------------------------------*/
 int sdram_leveling(void);
+extern int sdram_tap_evaluations;
+
+/*-----------------------------------------------------------------------*/
+/* Training Results                                                      */
+/*-----------------------------------------------------------------------*/
+/*
+ * Delays and bitslips the leveling picked, per module. The record has room
+ * for SDRAM_TRAINING_MODULES modules so its layout does not depend on the
+ * PHY, sdram.c checks that SDRAM_PHY_MODULES fits.
+ */
+#define SDRAM_TRAINING_MODULES 16
+
+struct sdram_training_s {
+    int32_t clock_delay;
+    int32_t write_dq_delay[SDRAM_TRAINING_MODULES];
+    int32_t write_dqs_delay[SDRAM_TRAINING_MODULES];
+    int32_t write_dq_bitslip[SDRAM_TRAINING_MODULES];
+    int32_t read_dq_delay[SDRAM_TRAINING_MODULES];
+    int32_t read_dq_bitslip[SDRAM_TRAINING_MODULES];
+    uint32_t checksum;
+};
+
+void sdram_training_save(struct sdram_training_s *training);
+int sdram_training_restore(const struct sdram_training_s *training);
+
+/*-----------------------------------------------------------------------*/
+/* Drift Tracking                                                        */
+/*-----------------------------------------------------------------------*/
+int sdram_track_drift(int margin);
 
 /*-----------------------------------------------------------------------*/
 /* Initialization                                                        */
 /*-----------------------------------------------------------------------*/
 int sdram_init(void);
+int sdram_init_training(struct sdram_training_s *training);
 int sdram_set_timings(struct sdram_timings_s *timings);
 int sdram_timings_init(void);
 
@@ -0,0 +1,60 @@
+// This file is Copyright (c) 2023 Antmicro <www.antmicro.com>
+// License: BSD
+
+#include <stdio.h>
+#include <string.h>
+
+#include <generated/soc.h>
+#include <liblitedram/sdram_profile.h>
+
+#include "sim_host.h"
+
+struct sdram_profile_s sdram_profile[SDRAM_PROFILE_STAGES];
+
+static const char *const sdram_profile_names[SDRAM_PROFILE_STAGES] = {
+	[SDRAM_PROFILE_INIT]                      = "init",
+	[SDRAM_PROFILE_LEVELING]                  = "leveling",
+	[SDRAM_PROFILE_WRITE_LEVELING]            = "write leveling",
+	[SDRAM_PROFILE_CMD_DELAY_SCAN]            = "  cmd delay scan step",
+	[SDRAM_PROFILE_WRITE_LATENCY_CALIBRATION] = "write latency calibration",
+	[SDRAM_PROFILE_WRITE_DQ_DQS_TRAINING]     = "write dq-dqs training",
+	[SDRAM_PROFILE_READ_LEVELING]             = "read leveling",
+	[SDRAM_PROFILE_TEST_PATTERN]              = "  test pattern run",
+	[SDRAM_PROFILE_WRITE_LEVELING_TAP]        = "  write leveling tap",
+	[SDRAM_PROFILE_TRAINING_RESTORE]          = "training restore",
+	[SDRAM_PROFILE_DDR5_CS_CA_TRAINING]       = "ddr5 cs/ca training",
+	[SDRAM_PROFILE_DDR5_ENUMERATE]            = "ddr5 enumerate",
+	[SDRAM_PROFILE_DDR5_READ_TRAINING]        = "ddr5 read training",
+	[SDRAM_PROFILE_DDR5_WRITE_TRAINING]       = "ddr5 write training",
+};
+
+void sdram_profile_reset(void) {
+	memset(sdram_profile, 0, sizeof(sdram_profile));
+	hpm_start();
+}
+
+void sdram_profile_print(void) {
+	const uint32_t total = sdram_profile[SDRAM_PROFILE_INIT].cycles;
+	int stage;
+
+	if (hpm_counters() == 0)
+		printf("No performance counters, build the model with HPM_COUNTERS=10 for the wait cycles\n");
+
+	printf("Training profile:\n");
+	printf("%-26s %5s %11s %11s %5s %9s %4s %11s %11s\n",
+		"stage", "runs", "cycles", "instret", "CPI", "us", "%", "fetch wait", "load wait");
+	for (stage = 0; stage < SDRAM_PROFILE_STAGES; stage++) {
+		const struct sdram_profile_s *p = &sdram_profile[stage];
+		unsigned int cpi = p->instret ? (uint64_t)p->cycles*100/p->instret : 0;
+		if (p->runs == 0)
+			continue;
+		printf("%-26s %5lu %11lu %11lu %2u.%02u %9lu %4u %11lu %11lu\n",
+			sdram_profile_names[stage], (unsigned long)p->runs,
+			(unsigned long)p->cycles, (unsigned long)p->instret, cpi/100, cpi%100,
+			(unsigned long)(p->cycles/(CONFIG_CLOCK_FREQUENCY/1000000)),
+			total ? (unsigned int)((uint64_t)p->cycles*100/total) : 0,
+			(unsigned long)p->fetch_wait, (unsigned long)p->load_wait);
+	}
+
+	sim_dump(sdram_profile, sizeof(sdram_profile));
+}
@@ -0,0 +1,82 @@
+// This file is Copyright (c) 2023 Antmicro <www.antmicro.com>
+// License: BSD
+
+#ifndef __SDRAM_PROFILE_H
+#define __SDRAM_PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <system.h>
+#include <hpm.h>
+
+/* Stages of the SDRAM initialization timed with SDRAM_PROFILE_BEGIN/END */
+enum sdram_profile_stage {
+	SDRAM_PROFILE_INIT,
+	SDRAM_PROFILE_LEVELING,
+	SDRAM_PROFILE_WRITE_LEVELING,
+	SDRAM_PROFILE_CMD_DELAY_SCAN,
+	SDRAM_PROFILE_WRITE_LATENCY_CALIBRATION,
+	SDRAM_PROFILE_WRITE_DQ_DQS_TRAINING,
+	SDRAM_PROFILE_READ_LEVELING,
+	SDRAM_PROFILE_TEST_PATTERN,
+	SDRAM_PROFILE_WRITE_LEVELING_TAP,
+	SDRAM_PROFILE_TRAINING_RESTORE,
+	SDRAM_PROFILE_DDR5_CS_CA_TRAINING,
+	SDRAM_PROFILE_DDR5_ENUMERATE,
+	SDRAM_PROFILE_DDR5_READ_TRAINING,
+	SDRAM_PROFILE_DDR5_WRITE_TRAINING,
+	SDRAM_PROFILE_STAGES
+};
+
+/*
+ * Totals of a stage over all of its runs since sdram_profile_reset(). The
+ * table is also written to the host channel of the simulation as a memory
+ * dump, one entry of 9 words per stage in the order of the enum. The wait
+ * cycles need a model built with HPM_COUNTERS, they stay 0 otherwise.
+ */
+struct sdram_profile_s {
+	uint32_t runs;
+	uint32_t cycles;        /* mcycle */
+	uint32_t instret;       /* minstret */
+	uint32_t load_wait;     /* mhpmcounter3 */
+	uint32_t fetch_wait;    /* mhpmcounter4 */
+	uint32_t start_cycle;   /* Counters at the last SDRAM_PROFILE_BEGIN */
+	uint32_t start_instret;
+	uint32_t start_load_wait;
+	uint32_t start_fetch_wait;
+};
+
+extern struct sdram_profile_s sdram_profile[SDRAM_PROFILE_STAGES];
+
+#ifndef SDRAM_PROFILE_DISABLE
+#define SDRAM_PROFILE_BEGIN(stage) do { \
+	sdram_profile[stage].start_load_wait = csrr(mhpmcounter3); \
+	sdram_profile[stage].start_fetch_wait = csrr(mhpmcounter4); \
+	sdram_profile[stage].start_instret = csrr(minstret); \
+	sdram_profile[stage].start_cycle = csrr(mcycle); \
+} while (0)
+
+#define SDRAM_PROFILE_END(stage) do { \
+	sdram_profile[stage].cycles += (uint32_t)csrr(mcycle) - sdram_profile[stage].start_cycle; \
+	sdram_profile[stage].instret += (uint32_t)csrr(minstret) - sdram_profile[stage].start_instret; \
+	sdram_profile[stage].fetch_wait += (uint32_t)csrr(mhpmcounter4) - sdram_profile[stage].start_fetch_wait; \
+	sdram_profile[stage].load_wait += (uint32_t)csrr(mhpmcounter3) - sdram_profile[stage].start_load_wait; \
+	sdram_profile[stage].runs++; \
+} while (0)
+#else
+#define SDRAM_PROFILE_BEGIN(stage) do {} while (0)
+#define SDRAM_PROFILE_END(stage) do {} while (0)
+#endif // SDRAM_PROFILE_DISABLE
+
+void sdram_profile_reset(void);
+/* Prints the stages that ran and dumps the table to the host channel */
+void sdram_profile_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SDRAM_PROFILE_H */
@@ -2,12 +2,40 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <generated/soc.h>
 #include <liblitedram/sdram.h>
+#include <system.h>
 #include "uart.h"
 #include "dfi_gpio.h"
+#include "sim_host.h"
 
 volatile uint32_t* dfi_gpio_regs = (uint32_t *)REG_DFI_GPIO;
 
+/* Training results of the last init, the SoC stays powered between triggers */
+static struct sdram_training_s training;
+
+#ifdef SDRAM_DRIFT_TRACKING_MS
+/* Taps probed on both sides of the delays, less than half of their windows */
+#ifndef SDRAM_DRIFT_MARGIN
+#define SDRAM_DRIFT_MARGIN 4
+#endif
+
+/* Waits for the release of the trigger, tracking the drift of the delays */
+static void wait_release_tracking(void)
+{
+    const uint32_t interval = SDRAM_DRIFT_TRACKING_MS * (CONFIG_CLOCK_FREQUENCY / 1000);
+    uint32_t start = csrr(mcycle);
+
+    while ((dfi_gpio_regs[DFI_GPIO_INIT_START] & 1) == 1) {
+        if ((uint32_t)csrr(mcycle) - start < interval)
+            continue;
+        if (sdram_track_drift(SDRAM_DRIFT_MARGIN))
+            sdram_training_save(&training);
+        start = csrr(mcycle);
+    }
+}
+#endif
+
 int main(void)
 {
     uart_init(115200);
@@ -20,13 +48,19 @@ int main(void)
         while ((dfi_gpio_regs[DFI_GPIO_INIT_START] & 1) == 0) {}
 
         puts("-- init start");
-        sdram_init();
+        sim_mark(1, "sdram init");
+        sdram_init_training(&training);
+        sim_mark(0, NULL);
         puts("-- init done");
 
         dfi_gpio_regs[DFI_GPIO_INIT_DONE] = 0x01;
 
         puts("-- wait release");
+#ifdef SDRAM_DRIFT_TRACKING_MS
+        wait_release_tracking();
+#else
         while ((dfi_gpio_regs[DFI_GPIO_INIT_START] & 1) == 1) {}
+#endif
     }
 
     return 0;
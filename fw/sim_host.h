@@ -0,0 +1,60 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_HOST_H
+#define SIM_HOST_H
+
+#include <stdint.h>
+
+// Simulation host channel, see src/sim_host.h. The helpers below only store
+// to it in firmware built for the simulation (SIM=1 in fw/Makefile), on
+// hardware they compile to nothing.
+#define SIM_HOST_ARG    0x801FFFF8
+#define SIM_HOST_CMD    0x801FFFFC
+
+#define SIM_CMD_PUTC    0x01
+#define SIM_CMD_EXIT    0x02
+#define SIM_CMD_MARK    0x03
+#define SIM_CMD_DUMP    0x04
+#define SIM_CMD_TRAP    0x05
+
+static inline void sim_host_cmd(uint32_t cmd, uint32_t arg) {
+#ifdef SIM_HOST_CHANNEL
+    *(volatile uint32_t *)SIM_HOST_CMD = (cmd << 24) | (arg & 0xFFFFFF);
+#else
+    (void)cmd;
+    (void)arg;
+#endif
+}
+
+static inline void sim_host_arg(uint32_t arg) {
+#ifdef SIM_HOST_CHANNEL
+    *(volatile uint32_t *)SIM_HOST_ARG = arg;
+#else
+    (void)arg;
+#endif
+}
+
+static inline void sim_putc(char c) {
+    sim_host_cmd(SIM_CMD_PUTC, (uint8_t)c);
+}
+
+static inline void sim_exit(int code) {
+    sim_host_cmd(SIM_CMD_EXIT, code);
+}
+
+// Starts a named phase, reported with its cycle count and wall time at the
+// end of the simulation. Phase 0 ends the current one.
+static inline void sim_mark(uint32_t phase, const char *name) {
+    sim_host_arg((uint32_t)name);
+    sim_host_cmd(SIM_CMD_MARK, phase);
+}
+
+// Writes size bytes at buf to a binary file on the host
+static inline void sim_dump(const void *buf, uint32_t size) {
+    sim_host_arg((uint32_t)buf);
+    sim_host_cmd(SIM_CMD_DUMP, size);
+}
+
+#endif
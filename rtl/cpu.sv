@@ -30,22 +30,51 @@ module cpu import ibex_pkg::*; import tlul_pkg::*; (
 
   ibex_pkg::crash_dump_t crash_dump_nc;
 
+  // Number of implemented performance event counters (mhpmcounter3 and up),
+  // set from HPM_COUNTERS of the Makefile
+`ifndef IBEX_MHPM_COUNTERS
+`define IBEX_MHPM_COUNTERS 0
+`endif
+
+  // CPU profile, set from CPU of the Makefile. "minimal" is the smallest
+  // Ibex, "perf" adds the multiplier, the instruction cache and optionally
+  // the writeback stage and the branch target ALU.
+`ifdef IBEX_PERF
+`ifndef IBEX_WRITEBACK_STAGE
+`define IBEX_WRITEBACK_STAGE 0
+`endif
+`ifndef IBEX_BRANCH_TARGET_ALU
+`define IBEX_BRANCH_TARGET_ALU 0
+`endif
+  localparam bit               CpuRV32E            = 1'b0;
+  localparam ibex_pkg::rv32m_e CpuRV32M            = ibex_pkg::RV32MFast;
+  localparam bit               CpuICache           = 1'b1;
+  localparam bit               CpuWritebackStage   = `IBEX_WRITEBACK_STAGE;
+  localparam bit               CpuBranchTargetALU  = `IBEX_BRANCH_TARGET_ALU;
+`else
+  localparam bit               CpuRV32E            = 1'b1;
+  localparam ibex_pkg::rv32m_e CpuRV32M            = ibex_pkg::RV32MNone;
+  localparam bit               CpuICache           = 1'b0;
+  localparam bit               CpuWritebackStage   = 1'b0;
+  localparam bit               CpuBranchTargetALU  = 1'b0;
+`endif
+
   // Ibex core
   ibex_tlul_top #(
     .ICacheScramble         (1'b0),
     .PMPEnable              (1'b0),
     .PMPGranularity         (0),
     .PMPNumRegions          (4),
-    .MHPMCounterNum         (0),
+    .MHPMCounterNum         (`IBEX_MHPM_COUNTERS),
     .MHPMCounterWidth       (40),
-    .RV32E                  (1'b1),
-    .RV32M                  (ibex_pkg::RV32MNone),
+    .RV32E                  (CpuRV32E),
+    .RV32M                  (CpuRV32M),
     .RV32B                  (ibex_pkg::RV32BNone),
     .RegFile                (ibex_pkg::RegFileFPGA),
-    .BranchTargetALU        (1'b0),
-    .ICache                 (1'b0),
+    .BranchTargetALU        (CpuBranchTargetALU),
+    .ICache                 (CpuICache),
     .ICacheECC              (1'b0),
-    .WritebackStage         (1'b0),
+    .WritebackStage         (CpuWritebackStage),
     .BranchPredictor        (1'b0),
     .DbgTriggerEn           (1'b0),
     .DmHaltAddr             (32'h00100000), // TODO
@@ -0,0 +1,248 @@
+// Copyright Antmicro 2023
+// SPDX-License-Identifier: Apache-2.0
+`timescale 1ns / 1ps
+
+// Stand-in for the generated phy_core of the DFI build (make
+// verilator-build-dfi). The PHY and the DFI injector are modelled at
+// transaction level in C++ (src/sim_dfi.cpp), this module only forwards the
+// CSR bus there. No serdes, delay lines or fast clocks are simulated, the
+// sys clock domain follows the input clock and the DRAM pins stay idle.
+module phy_core (
+    input  wire        clk,
+    input  wire        rst,
+    output wire        clk_idelay,
+    output wire        rst_idelay,
+    output wire        clk_sys,
+    output wire        rst_sys,
+    output wire        clk_sys2x,
+    output wire        rst_sys2x,
+    output wire        clk_sys8x,
+    output wire        rst_sys8x,
+
+    output wire [ 5:0] ddram_ca,
+    output wire        ddram_cs,
+    inout  wire [15:0] ddram_dq,
+    inout  wire [ 1:0] ddram_dqs_p,
+    inout  wire [ 1:0] ddram_dqs_n,
+    inout  wire [ 1:0] ddram_dmi,
+    output wire        ddram_clk_p,
+    output wire        ddram_clk_n,
+    output wire        ddram_cke,
+    output wire        ddram_odt,
+    output wire        ddram_reset_n,
+    input  wire        dfi_cke_p0,
+    input  wire        dfi_reset_n_p0,
+    input  wire        dfi_mode_2n_p0,
+    output wire        dfi_alert_n_w0,
+    input  wire [16:0] dfi_address_p0,
+    input  wire [ 5:0] dfi_bank_p0,
+    input  wire        dfi_cas_n_p0,
+    input  wire        dfi_cs_n_p0,
+    input  wire        dfi_ras_n_p0,
+    input  wire        dfi_act_n_p0,
+    input  wire        dfi_odt_p0,
+    input  wire        dfi_we_n_p0,
+    input  wire [31:0] dfi_wrdata_p0,
+    input  wire        dfi_wrdata_en_p0,
+    input  wire [ 3:0] dfi_wrdata_mask_p0,
+    input  wire        dfi_rddata_en_p0,
+    output wire [31:0] dfi_rddata_w0,
+    output wire        dfi_rddata_valid_w0,
+    input  wire        dfi_cke_p1,
+    input  wire        dfi_reset_n_p1,
+    input  wire        dfi_mode_2n_p1,
+    output wire        dfi_alert_n_w1,
+    input  wire [16:0] dfi_address_p1,
+    input  wire [ 5:0] dfi_bank_p1,
+    input  wire        dfi_cas_n_p1,
+    input  wire        dfi_cs_n_p1,
+    input  wire        dfi_ras_n_p1,
+    input  wire        dfi_act_n_p1,
+    input  wire        dfi_odt_p1,
+    input  wire        dfi_we_n_p1,
+    input  wire [31:0] dfi_wrdata_p1,
+    input  wire        dfi_wrdata_en_p1,
+    input  wire [ 3:0] dfi_wrdata_mask_p1,
+    input  wire        dfi_rddata_en_p1,
+    output wire [31:0] dfi_rddata_w1,
+    output wire        dfi_rddata_valid_w1,
+    input  wire        dfi_cke_p2,
+    input  wire        dfi_reset_n_p2,
+    input  wire        dfi_mode_2n_p2,
+    output wire        dfi_alert_n_w2,
+    input  wire [16:0] dfi_address_p2,
+    input  wire [ 5:0] dfi_bank_p2,
+    input  wire        dfi_cas_n_p2,
+    input  wire        dfi_cs_n_p2,
+    input  wire        dfi_ras_n_p2,
+    input  wire        dfi_act_n_p2,
+    input  wire        dfi_odt_p2,
+    input  wire        dfi_we_n_p2,
+    input  wire [31:0] dfi_wrdata_p2,
+    input  wire        dfi_wrdata_en_p2,
+    input  wire [ 3:0] dfi_wrdata_mask_p2,
+    input  wire        dfi_rddata_en_p2,
+    output wire [31:0] dfi_rddata_w2,
+    output wire        dfi_rddata_valid_w2,
+    input  wire        dfi_cke_p3,
+    input  wire        dfi_reset_n_p3,
+    input  wire        dfi_mode_2n_p3,
+    output wire        dfi_alert_n_w3,
+    input  wire [16:0] dfi_address_p3,
+    input  wire [ 5:0] dfi_bank_p3,
+    input  wire        dfi_cas_n_p3,
+    input  wire        dfi_cs_n_p3,
+    input  wire        dfi_ras_n_p3,
+    input  wire        dfi_act_n_p3,
+    input  wire        dfi_odt_p3,
+    input  wire        dfi_we_n_p3,
+    input  wire [31:0] dfi_wrdata_p3,
+    input  wire        dfi_wrdata_en_p3,
+    input  wire [ 3:0] dfi_wrdata_mask_p3,
+    input  wire        dfi_rddata_en_p3,
+    output wire [31:0] dfi_rddata_w3,
+    output wire        dfi_rddata_valid_w3,
+    input  wire        dfi_cke_p4,
+    input  wire        dfi_reset_n_p4,
+    input  wire        dfi_mode_2n_p4,
+    output wire        dfi_alert_n_w4,
+    input  wire [16:0] dfi_address_p4,
+    input  wire [ 5:0] dfi_bank_p4,
+    input  wire        dfi_cas_n_p4,
+    input  wire        dfi_cs_n_p4,
+    input  wire        dfi_ras_n_p4,
+    input  wire        dfi_act_n_p4,
+    input  wire        dfi_odt_p4,
+    input  wire        dfi_we_n_p4,
+    input  wire [31:0] dfi_wrdata_p4,
+    input  wire        dfi_wrdata_en_p4,
+    input  wire [ 3:0] dfi_wrdata_mask_p4,
+    input  wire        dfi_rddata_en_p4,
+    output wire [31:0] dfi_rddata_w4,
+    output wire        dfi_rddata_valid_w4,
+    input  wire        dfi_cke_p5,
+    input  wire        dfi_reset_n_p5,
+    input  wire        dfi_mode_2n_p5,
+    output wire        dfi_alert_n_w5,
+    input  wire [16:0] dfi_address_p5,
+    input  wire [ 5:0] dfi_bank_p5,
+    input  wire        dfi_cas_n_p5,
+    input  wire        dfi_cs_n_p5,
+    input  wire        dfi_ras_n_p5,
+    input  wire        dfi_act_n_p5,
+    input  wire        dfi_odt_p5,
+    input  wire        dfi_we_n_p5,
+    input  wire [31:0] dfi_wrdata_p5,
+    input  wire        dfi_wrdata_en_p5,
+    input  wire [ 3:0] dfi_wrdata_mask_p5,
+    input  wire        dfi_rddata_en_p5,
+    output wire [31:0] dfi_rddata_w5,
+    output wire        dfi_rddata_valid_w5,
+    input  wire        dfi_cke_p6,
+    input  wire        dfi_reset_n_p6,
+    input  wire        dfi_mode_2n_p6,
+    output wire        dfi_alert_n_w6,
+    input  wire [16:0] dfi_address_p6,
+    input  wire [ 5:0] dfi_bank_p6,
+    input  wire        dfi_cas_n_p6,
+    input  wire        dfi_cs_n_p6,
+    input  wire        dfi_ras_n_p6,
+    input  wire        dfi_act_n_p6,
+    input  wire        dfi_odt_p6,
+    input  wire        dfi_we_n_p6,
+    input  wire [31:0] dfi_wrdata_p6,
+    input  wire        dfi_wrdata_en_p6,
+    input  wire [ 3:0] dfi_wrdata_mask_p6,
+    input  wire        dfi_rddata_en_p6,
+    output wire [31:0] dfi_rddata_w6,
+    output wire        dfi_rddata_valid_w6,
+    input  wire        dfi_cke_p7,
+    input  wire        dfi_reset_n_p7,
+    input  wire        dfi_mode_2n_p7,
+    output wire        dfi_alert_n_w7,
+    input  wire [16:0] dfi_address_p7,
+    input  wire [ 5:0] dfi_bank_p7,
+    input  wire        dfi_cas_n_p7,
+    input  wire        dfi_cs_n_p7,
+    input  wire        dfi_ras_n_p7,
+    input  wire        dfi_act_n_p7,
+    input  wire        dfi_odt_p7,
+    input  wire        dfi_we_n_p7,
+    input  wire [31:0] dfi_wrdata_p7,
+    input  wire        dfi_wrdata_en_p7,
+    input  wire [ 3:0] dfi_wrdata_mask_p7,
+    input  wire        dfi_rddata_en_p7,
+    output wire [31:0] dfi_rddata_w7,
+    output wire        dfi_rddata_valid_w7,
+    input  wire [ 9:0] csr_adr,
+    input  wire        csr_we,
+    input  wire [31:0] csr_dat_w,
+    output reg  [31:0] csr_dat_r
+);
+
+  import "DPI-C" function int  sim_dfi_csr_read (input int addr);
+  import "DPI-C" function void sim_dfi_csr_write(input int addr, input int data);
+
+  // Clocks and resets, the sys reset is synchronized like in the CRG
+  reg [1:0] rst_sync = 2'b11;
+
+  always @(posedge clk or posedge rst)
+    if (rst) rst_sync <= 2'b11;
+    else     rst_sync <= {rst_sync[0], 1'b0};
+
+  assign clk_sys    = clk;
+  assign rst_sys    = rst_sync[1];
+  assign clk_sys2x  = 1'b0;
+  assign rst_sys2x  = rst_sync[1];
+  assign clk_sys8x  = 1'b0;
+  assign rst_sys8x  = rst_sync[1];
+  assign clk_idelay = 1'b0;
+  assign rst_idelay = rst_sync[1];
+
+  // CSR bus, read data is registered like in the LiteX CSR bank
+  always @(posedge clk_sys) begin
+    csr_dat_r <= sim_dfi_csr_read(32'(csr_adr));
+    if (csr_we)
+      sim_dfi_csr_write(32'(csr_adr), csr_dat_w);
+  end
+
+  // DRAM pins, the device is driven by the model directly
+  assign ddram_ca      = '0;
+  assign ddram_cs      = 1'b0;
+  assign ddram_dq      = 'z;
+  assign ddram_dqs_p   = 'z;
+  assign ddram_dqs_n   = 'z;
+  assign ddram_dmi     = 'z;
+  assign ddram_clk_p   = 1'b0;
+  assign ddram_clk_n   = 1'b1;
+  assign ddram_cke     = 1'b0;
+  assign ddram_odt     = 1'b0;
+  assign ddram_reset_n = 1'b0;
+
+  // DFI of the hardware path, not modelled
+  assign dfi_alert_n_w0       = 1'b1;
+  assign dfi_rddata_w0        = '0;
+  assign dfi_rddata_valid_w0  = '0;
+  assign dfi_alert_n_w1       = 1'b1;
+  assign dfi_rddata_w1        = '0;
+  assign dfi_rddata_valid_w1  = '0;
+  assign dfi_alert_n_w2       = 1'b1;
+  assign dfi_rddata_w2        = '0;
+  assign dfi_rddata_valid_w2  = '0;
+  assign dfi_alert_n_w3       = 1'b1;
+  assign dfi_rddata_w3        = '0;
+  assign dfi_rddata_valid_w3  = '0;
+  assign dfi_alert_n_w4       = 1'b1;
+  assign dfi_rddata_w4        = '0;
+  assign dfi_rddata_valid_w4  = '0;
+  assign dfi_alert_n_w5       = 1'b1;
+  assign dfi_rddata_w5        = '0;
+  assign dfi_rddata_valid_w5  = '0;
+  assign dfi_alert_n_w6       = 1'b1;
+  assign dfi_rddata_w6        = '0;
+  assign dfi_rddata_valid_w6  = '0;
+  assign dfi_alert_n_w7       = 1'b1;
+  assign dfi_rddata_w7        = '0;
+  assign dfi_rddata_valid_w7  = '0;
+
+endmodule
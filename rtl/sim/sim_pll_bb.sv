@@ -30,14 +30,47 @@ module PLLE2_ADV #(
 	output logic    LOCKED
 );
 
-initial CLKOUT1 = 1'b0;
-always #0.25   CLKOUT1 <= !CLKOUT1;
+`ifdef SIM_CPP_CLOCKS
+// Clocks are generated by the testbench and fed through sim_top ports
+assign CLKOUT1 = sim_top.clk_sys2x_i;
+assign CLKOUT2 = sim_top.clk_sys8x_i;
+assign CLKOUT3 = sim_top.clk_idelay_i;
+`else
+// Same ratios and phases as the clock schedule of the CLOCKING=cpp build
+// (src/sim_clocks.cpp), relative to the rising edges of sys at 0.5 + k ns.
+// Half periods that are not a whole number of ps alternate between the two
+// closest values so the periods stay exact.
 
-initial CLKOUT2 = 1'b0;
-always #0.03125  CLKOUT2 <= !CLKOUT2;
+// sys2x at 2x, rising with sys
+initial CLKOUT1 = 1'b1;
+always #0.25 CLKOUT1 <= !CLKOUT1;
 
-initial CLKOUT3 = 1'b0;
-always #0.09375 CLKOUT3 <= !CLKOUT3;
+// sys8x at 8x with -45 degrees phase. It only clocks the bit level serdes
+// models, with the word level ones (sim_serdes.sv) it is generated on request
+initial begin
+  CLKOUT2 = 1'b0;
+  if ($test$plusargs("sys8x")) begin
+    CLKOUT2 = 1'b1;
+    #0.047 CLKOUT2 = 1'b0;
+    forever begin
+      #0.062 CLKOUT2 = 1'b1;
+      #0.063 CLKOUT2 = 1'b0;
+    end
+  end
+end
+
+// idelay at 8/3x (200MHz for a 75MHz sys clock), rising with sys every 3
+// sys cycles
+initial begin
+  CLKOUT3 = 1'b0;
+  #0.125;
+  forever begin
+    CLKOUT3 = 1'b1;
+    #0.188 CLKOUT3 = 1'b0;
+    #0.187;
+  end
+end
+`endif
 
 assign CLKOUT0 = CLKIN1;
 assign LOCKED = 1'b1;
@@ -24,7 +24,8 @@ module sim_rom # (
   // The memory
   (* ram_style = "block" *)
   logic [7:0] mem [SIZE];
-  initial $readmemh(FILE, mem);
+  // Contents are loaded by the testbench when running an ELF file
+  initial if (!$test$plusargs("elf")) $readmemh(FILE, mem);
 
   // Read logic
   wire [DW-1:0] data;
@@ -1,6 +1,21 @@
 // Copyright Antmicro 2023
 // SPDX-License-Identifier: Apache-2.0
 
+// Word level models of the 7 series serdes and delay primitives. Instead of
+// shifting bits on every CLK edge, OSERDESE2 hands the whole parallel word
+// to the testbench on each CLKDIV edge and ISERDESE2 fetches one, the
+// testbench (src/sim_serdes.cpp) replays the words through the LPDDR4
+// device and the channel model. IDELAYE2/ODELAYE2 only keep the tap count
+// and report it. Instances are matched with DRAM pads by their name using
+// the map generated from the PHY netlist (src/serdes_map.py). The serial
+// outputs stay constant, an instance missing from the map stays idle.
+
+import "DPI-C" function int sim_serdes_attach(input int kind, input string path);
+import "DPI-C" function void sim_oserdes_word(input int id, input longint count,
+                                             input byte data, input byte oe);
+import "DPI-C" function byte sim_iserdes_word(input int id, input longint count);
+import "DPI-C" function void sim_delay_taps(input int id, input int taps);
+
 module ISERDESE2 (O, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, SHIFTOUT1, SHIFTOUT2, BITSLIP, CE1, CE2, CLK, CLKB, CLKDIV, CLKDIVP, D, DDLY, DYNCLKDIVSEL, DYNCLKSEL, OCLK, OCLKB, OFB, RST, SHIFTIN1, SHIFTIN2);
   parameter DATA_RATE = "DDR";
   parameter integer DATA_WIDTH = 4;
@@ -60,6 +75,46 @@ module ISERDESE2 (O, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, SHIFTOUT1, SHIFTOUT2, BITSL
   input RST;
   input SHIFTIN1;
   input SHIFTIN2;
+
+  // Bit k of the words is the k-th bit in time, Q8 is the oldest one
+  int         id;
+  longint     count;
+  logic [7:0] prev, word;
+  logic [2:0] slip;   // Bits the word is moved by
+
+  initial begin
+    id    = sim_serdes_attach(0, $sformatf("%m"));
+    count = 0;
+    prev  = '0;
+    word  = '0;
+    slip  = '0;
+  end
+
+  always @(posedge CLKDIV) begin
+    logic [ 7:0] din;
+    logic [15:0] stream;
+    count = count + 1;
+    din = id >= 0 ? sim_iserdes_word(id, count) : '0;
+    // 4 bit words sample every second bit of the 8 bit stream
+    if (DATA_WIDTH == 4)
+      din = {4'b0, din[6], din[4], din[2], din[0]};
+    if (RST) begin
+      slip = '0;
+      prev = '0;
+      word <= '0;
+    end else begin
+      if (BITSLIP)
+        slip = slip == 3'(DATA_WIDTH - 1) ? '0 : slip + 3'd1;
+      stream = DATA_WIDTH == 4 ? {8'b0, din[3:0], prev[3:0]} : {din, prev};
+      word  <= 8'(stream >> slip);
+      prev   = din;
+    end
+  end
+
+  assign {Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8} = DATA_WIDTH == 4 ? {word[3:0], 4'b0} : word;
+  assign O         = IOBDELAY == "NONE" || IOBDELAY == "IFD" ? D : DDLY;
+  assign SHIFTOUT1 = 1'b0;
+  assign SHIFTOUT2 = 1'b0;
 endmodule
 
 module B_ISERDESE2 #(
@@ -174,6 +229,38 @@ module OSERDESE2 (OFB, OQ, SHIFTOUT1, SHIFTOUT2, TBYTEOUT, TFB, TQ, CLK, CLKDIV,
   input T4;
   input TBYTEIN;
   input TCE;
+
+  // Bit k of the words is the k-th bit in time, D1 goes first
+  int     id;
+  longint count;
+
+  initial begin
+    id    = sim_serdes_attach(1, $sformatf("%m"));
+    count = 0;
+  end
+
+  always @(posedge CLKDIV) begin
+    logic [7:0] data, t;
+    count = count + 1;
+    data = {D8, D7, D6, D5, D4, D3, D2, D1};
+    // T1-T4 cover 2 bits each with TRISTATE_WIDTH 4, T1 all of them otherwise
+    t = TRISTATE_WIDTH == 4 ?
+        {{2{T4}}, {2{T3}}, {2{T2}}, {2{T1}}} : {8{T1}};
+    // Bits of 4 bit words last twice as long
+    if (DATA_WIDTH == 4)
+      data = {{2{D4}}, {2{D3}}, {2{D2}}, {2{D1}}};
+    if (id >= 0 && !RST)
+      sim_oserdes_word(id, count, data, ~t);
+  end
+
+  // The pads are driven by the testbench, keep the buffers released
+  assign OQ        = INIT_OQ;
+  assign OFB       = INIT_OQ;
+  assign TQ        = 1'b1;
+  assign TFB       = 1'b1;
+  assign TBYTEOUT  = 1'b1;
+  assign SHIFTOUT1 = 1'b0;
+  assign SHIFTOUT2 = 1'b0;
 endmodule
 
 module B_OSERDESE2 #(
@@ -256,6 +343,34 @@ module IDELAYE2 (CNTVALUEOUT, DATAOUT, C, CE, CINVCTRL, CNTVALUEIN, DATAIN, IDAT
     input LD;
     input LDPIPEEN;
     input REGRST;
+
+    int       id;
+    reg [4:0] tap;
+
+    initial begin
+      id  = sim_serdes_attach(2, $sformatf("%m"));
+      tap = 5'(IDELAY_VALUE);
+      if (id >= 0)
+        sim_delay_taps(id, int'(tap));
+    end
+
+    // LD loads the initial value (VARIABLE) or CNTVALUEIN (VAR_LOAD), CE
+    // moves by one tap and wraps around like the hardware
+    always @(posedge C) begin
+      logic [4:0] next;
+      if (IDELAY_TYPE != "FIXED" && (LD || CE)) begin
+        if (LD)
+          next = IDELAY_TYPE == "VARIABLE" ? 5'(IDELAY_VALUE) : CNTVALUEIN;
+        else
+          next = INC ? tap + 5'd1 : tap - 5'd1;
+        tap <= next;
+        if (id >= 0)
+          sim_delay_taps(id, int'(next));
+      end
+    end
+
+    assign CNTVALUEOUT = tap;
+    assign DATAOUT     = DELAY_SRC == "DATAIN" ? DATAIN : IDATAIN;
 endmodule
 
 module ODELAYE2 (CNTVALUEOUT, DATAOUT, C, CE, CINVCTRL, CLKIN, CNTVALUEIN, INC, LD, LDPIPEEN, ODATAIN, REGRST);
@@ -293,4 +408,30 @@ module ODELAYE2 (CNTVALUEOUT, DATAOUT, C, CE, CINVCTRL, CLKIN, CNTVALUEIN, INC,
     input LDPIPEEN;
     input ODATAIN;
     input REGRST;
+
+    int       id;
+    reg [4:0] tap;
+
+    initial begin
+      id  = sim_serdes_attach(3, $sformatf("%m"));
+      tap = 5'(ODELAY_VALUE);
+      if (id >= 0)
+        sim_delay_taps(id, int'(tap));
+    end
+
+    always @(posedge C) begin
+      logic [4:0] next;
+      if (ODELAY_TYPE != "FIXED" && (LD || CE)) begin
+        if (LD)
+          next = ODELAY_TYPE == "VARIABLE" ? 5'(ODELAY_VALUE) : CNTVALUEIN;
+        else
+          next = INC ? tap + 5'd1 : tap - 5'd1;
+        tap <= next;
+        if (id >= 0)
+          sim_delay_taps(id, int'(next));
+      end
+    end
+
+    assign CNTVALUEOUT = tap;
+    assign DATAOUT     = DELAY_SRC == "CLKIN" ? CLKIN : ODATAIN;
 endmodule
@@ -2,18 +2,53 @@
 // SPDX-License-Identifier: Apache-2.0
 `timescale 1ns / 1ps
 
-module sim_top import mem_pkg::*; import top_pkg::*; ();
+module sim_top import mem_pkg::*; import top_pkg::*; (
+`ifdef SIM_CPP_CLOCKS
+    // Clocks driven by the testbench. The PLL model picks up the sys2x,
+    // sys8x and idelay ones from here.
+    input  logic clk_i,
+    input  logic clk_sys2x_i,
+    input  logic clk_sys8x_i,
+    input  logic clk_idelay_i,
+`endif
+    output logic clk_o,   // System clock, lets the testbench count cycles
+
+    input  logic [31:0] boot_addr_i,  // Set from the ELF entry point
+
+    // DFI init handshake, played by the testbench in place of the memory
+    // controller
+    input  logic        dfi_init_start_i,
+    output logic        dfi_init_done_o,
+
+    // UART TX line and baudrate setting, decoded by the testbench
+    output logic        uart_tx_o,
+    output logic [15:0] uart_nco_o,
+
+    // Memory bus monitor for the testbench watchdog (CPU byte addresses)
+    output logic        rom_req_o,
+    output logic [31:0] rom_addr_o,
+    output logic        ram_req_o,
+    output logic        ram_we_o,
+    output logic [31:0] ram_addr_o,
+    output logic [31:0] ram_wdata_o
+);
 
   // Clock generation
   logic clk;
+`ifdef SIM_CPP_CLOCKS
+  assign clk = clk_i;
+`else
   initial clk <= 1'b0;
   always #0.5 clk <= !clk;
+`endif
 
   // Reset generation
   logic rst_n;
   initial rst_n <= 1'b0;
   always @(posedge clk) rst_n <= 1'b1;
 
+  assign clk_o = clk;
+
   // Memory buses
   mem_pkg::mem_h2d_t rom_h2d;
   mem_pkg::mem_d2h_t rom_d2h;
@@ -22,6 +57,21 @@ module sim_top import mem_pkg::*; import top_pkg::*; ();
 
   logic uart_tx;
 
+  // DRAM pins. They are left open: the serdes models (sim_serdes.sv) and the
+  // DFI model exchange words with the LPDDR4 model (src/sim_lpddr4.cpp)
+  // directly, so nothing reaches the pads.
+  wire [ 5:0] ddram_ca;
+  wire        ddram_cs;
+  wire [15:0] ddram_dq;
+  wire [ 1:0] ddram_dqs_p;
+  wire [ 1:0] ddram_dqs_n;
+  wire [ 1:0] ddram_dmi;
+  wire        ddram_clk_p;
+  wire        ddram_clk_n;
+  wire        ddram_cke;
+  wire        ddram_odt;
+  wire        ddram_reset_n;
+
   glbl glbl();
   defparam glbl.ROC_WIDTH = 0.5;
 
@@ -30,13 +80,30 @@ module sim_top import mem_pkg::*; import top_pkg::*; ();
     .clk_i      (clk),
     .rst_ni     (rst_n),
 
+    .boot_addr_i(boot_addr_i),
+
     .rom_o      (rom_h2d),
     .rom_i      (rom_d2h),
     .ram_o      (ram_h2d),
     .ram_i      (ram_d2h),
 
     .tx         (uart_tx),
-    .rx         (1'b1)
+    .rx         (1'b1),
+
+    .dfi_init_start_i (dfi_init_start_i),
+    .dfi_init_done_o  (dfi_init_done_o),
+
+    .ddram_ca     (ddram_ca),
+    .ddram_cs     (ddram_cs),
+    .ddram_dq     (ddram_dq),
+    .ddram_dqs_p  (ddram_dqs_p),
+    .ddram_dqs_n  (ddram_dqs_n),
+    .ddram_dmi    (ddram_dmi),
+    .ddram_clk_p  (ddram_clk_p),
+    .ddram_clk_n  (ddram_clk_n),
+    .ddram_cke    (ddram_cke),
+    .ddram_odt    (ddram_odt),
+    .ddram_reset_n(ddram_reset_n)
   );
 
   // ROM memory model
@@ -79,35 +146,58 @@ module sim_top import mem_pkg::*; import top_pkg::*; ();
   assign ram_d2h.gnt    = 1'b1;
   assign ram_d2h.error  = 2'b00;
 
-  // "stdout"
-  integer stdout_fp;
-  initial stdout_fp = $fopen("stdout.txt", "wb");
+  // RAM write monitor. Forwards firmware writes to the testbench, which
+  // implements the host channel and reacts to marker addresses (trace and
+  // snapshot triggers). Both live in C++ so they are not part of a saved
+  // model state.
+  import "DPI-C" function void sim_mem_write(input int addr, input int data,
+                                             input byte mask);
 
-  logic [7:0] stdout;
   always @(posedge clk)
-    if (rst_n)
-      if (ram_h2d.req && ram_h2d.we && ram_h2d.addr == {top_pkg::MEM_AW{1'b1}}) begin
-
-        // Latch the byte
-        stdout = ram_h2d.data[7:0];
-
-        // When writing 0x00 or 0x80 - 0xFF terminate
-        if (ram_h2d.data[7:0] == 8'h00 || ram_h2d.data[7:0] >= 8'h80) begin
-            $finish();
-        // Otherwise write to stdout and file
-        end else begin
-            $fwrite(stdout_fp, "%c", ram_h2d.data[7:0]);
-            $write("%c", ram_h2d.data[7:0]);
-            $fflush();
-        end
-      end
-
-  // UART waveform dump
-  integer uart_fp;
-  initial uart_fp = $fopen("uart.bin", "wb");
-
-  always @(posedge clk) begin
-    $fwrite(uart_fp, "%c", uart_tx);
-  end
+    if (rst_n && ram_h2d.req && ram_h2d.we)
+      sim_mem_write(32'(ram_h2d.addr), ram_h2d.data, 8'(ram_h2d.mask));
+
+  // PHY CSR write monitor. The testbench keeps a shadow of the delay
+  // settings for the DRAM channel model.
+  import "DPI-C" function void sim_phy_csr_write(input int addr, input int data);
+
+  always @(posedge u_top.u_phy.clk_sys)
+    if (u_top.u_phy.csr_we)
+      sim_phy_csr_write(32'(u_top.u_phy.csr_adr), u_top.u_phy.csr_dat_w);
+
+  // Backdoor memory access for the host channel and the ELF loader. ROM is
+  // byte, RAM is word addressed.
+  export "DPI-C" function sim_ram_read;
+  export "DPI-C" function sim_ram_load;
+  export "DPI-C" function sim_rom_read;
+  export "DPI-C" function sim_rom_load;
+
+  function automatic int sim_ram_read(input int addr);
+    return u_ram.mem[addr[top_pkg::MEM_AW-1:0]];
+  endfunction
+
+  function automatic void sim_ram_load(input int addr, input int data);
+    u_ram.mem[addr[top_pkg::MEM_AW-1:0]] = data;
+  endfunction
+
+  function automatic byte sim_rom_read(input int addr);
+    return u_rom.mem[addr[top_pkg::MEM_AW-1:0]];
+  endfunction
+
+  function automatic void sim_rom_load(input int addr, input byte data);
+    u_rom.mem[addr[top_pkg::MEM_AW-1:0]] = data;
+  endfunction
+
+  // Memory bus monitor
+  assign rom_req_o   = rom_h2d.req;
+  assign rom_addr_o  = 32'h80000000 | (32'(rom_h2d.addr) << 2);
+  assign ram_req_o   = ram_h2d.req;
+  assign ram_we_o    = ram_h2d.we;
+  assign ram_addr_o  = 32'h80000000 | (32'(ram_h2d.addr) << 2);
+  assign ram_wdata_o = ram_h2d.data;
+
+  // UART
+  assign uart_tx_o  = uart_tx;
+  assign uart_nco_o = u_top.u_uart.reg2hw.ctrl.nco.q;
 
 endmodule
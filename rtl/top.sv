@@ -10,6 +10,9 @@ module dram_phy_soc_top
     input  wire clk_i,
     input  wire rst_ni,
 
+    // CPU boot address, first instruction is at boot_addr_i + 0x80
+    input  wire [31:0] boot_addr_i,
+
     // Clock and reset outputs
     output wire clk_1x_o,
     output wire rst_1x_o,
@@ -221,7 +224,7 @@ module dram_phy_soc_top
     .tl_i           (tl_cpu_d2h),
 
     .core_rst_ni    (rst_sys_n),
-    .boot_addr_i    (32'h80000000), // FIXME: Temporary.
+    .boot_addr_i    (boot_addr_i),
     .fetch_enable_i (1'b1),
     .timer_irq_i    (1'b0)
   );
@@ -288,6 +288,10 @@ class DRAMPHYSoC(LiteXModule, SoCCoreCompat):
         else:
             raise NotImplementedError
 
+        # DFI command to read data latency in sys clock cycles, the firmware
+        # derives its waits after the injector commands from it
+        self.add_constant("SDRAM_PHY_READ_LATENCY", phy.settings.read_latency)
+
         # DFI Injector --------------------------------------------------------
 
         self.submodules.sdram = sdram = DummyDRAMCore(phy, sdram_module)
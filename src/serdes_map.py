@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2023 Antmicro <www.antmicro.com>
+# SPDX-License-Identifier: Apache-2.0
+
+"""
+Maps the serdes and delay primitives of the generated PHY to DRAM pads.
+
+The simulation models of ISERDESE2, OSERDESE2, IDELAYE2 and ODELAYE2
+(rtl/sim/sim_serdes.sv) exchange whole words with the testbench instead of
+toggling the pads, so the testbench has to know which pad every instance
+serves. This script follows the nets of the generated netlist from each
+serdes through the delay lines and IO buffers to the ddram_* ports and
+writes one line per instance:
+
+    <instance> <iserdes|oserdes|idelay|odelay> <pad> [<clock net>]
+
+Pads are named like the signals of the channel model: ck, cs, cke, odt,
+reset_n, ca0-5, dq0-15, dqs0-1, dmi0-1.
+"""
+
+import re
+import sys
+import argparse
+
+# Netlist parsing ---------------------------------------------------------------------------------
+
+INSTANCE_RE = re.compile(r"^\s*(\w+)\s*(?:#\s*\((?P<params>.*?)\)\s*)?(?P<name>\w+)\s*\((?P<ports>.*?)\);",
+                         re.S | re.M)
+CONNECTION_RE = re.compile(r"\.(\w+)\s*\(([^()]*(?:\([^()]*\))*[^()]*)\)")
+ASSIGN_RE = re.compile(r"^\s*assign\s+([\w\[\]:]+)\s*=\s*([\w\[\]:]+)\s*;", re.M)
+
+PRIMITIVES = {"ISERDESE2", "OSERDESE2", "IDELAYE2", "ODELAYE2",
+              "IOBUF", "IOBUFDS", "OBUF", "OBUFDS", "OBUFT", "IBUF"}
+
+
+def strip_comments(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    return re.sub(r"//[^\n]*", "", text)
+
+
+def parse(text):
+    text = strip_comments(text)
+
+    instances = []
+    for m in INSTANCE_RE.finditer(text):
+        kind = m.group(1)
+        if kind not in PRIMITIVES:
+            continue
+        ports  = {p: e.strip() for p, e in CONNECTION_RE.findall(m.group("ports"))}
+        params = {p: e.strip() for p, e in CONNECTION_RE.findall(m.group("params") or "")}
+        instances.append({"kind": kind, "name": m.group("name"), "ports": ports, "params": params})
+
+    # Plain net aliases, "assign a = b;"
+    alias = {}
+    for dst, src in ASSIGN_RE.findall(text):
+        alias[dst] = src
+
+    return instances, alias
+
+
+def resolve(net, alias):
+    seen = set()
+    while net in alias and net not in seen:
+        seen.add(net)
+        net = alias[net]
+    return net
+
+# Pads --------------------------------------------------------------------------------------------
+
+PAD_RE = re.compile(r"^ddram_(\w+?)(?:_p)?(?:\[(\d+)\])?$")
+
+PAD_NAMES = {
+    "clk":     "ck",
+    "cs":      "cs",
+    "cke":     "cke",
+    "odt":     "odt",
+    "reset_n": "reset_n",
+    "ca":      "ca",
+    "dq":      "dq",
+    "dqs":     "dqs",
+    "dmi":     "dmi",
+}
+
+
+def pad_name(net):
+    m = PAD_RE.match(net.replace(" ", ""))
+    if m is None or m.group(1) not in PAD_NAMES:
+        return None
+    return PAD_NAMES[m.group(1)] + (m.group(2) or "")
+
+# Tracing -----------------------------------------------------------------------------------------
+
+# Buffer ports: (input from the fabric, output to the fabric, pad)
+BUFFERS = {
+    "IOBUF":   ("I", "O", "IO"),
+    "IOBUFDS": ("I", "O", "IO"),
+    "OBUF":    ("I", None, "O"),
+    "OBUFT":   ("I", None, "O"),
+    "OBUFDS":  ("I", None, "O"),
+    "IBUF":    (None, "O", "I"),
+}
+
+
+def trace(instances, alias):
+    def net(inst, port):
+        expr = inst["ports"].get(port)
+        return resolve(expr, alias) if expr else None
+
+    def driven_by(port_of, target):
+        if target is None:
+            return None
+        for inst in instances:
+            for kind, port in port_of:
+                if inst["kind"] == kind and net(inst, port) == target:
+                    return inst
+        return None
+
+    mapping = []
+    for inst in instances:
+        if inst["kind"] == "OSERDESE2":
+            # Delayed outputs leave through OFB
+            cur = net(inst, "OQ")
+            dly = driven_by([("ODELAYE2", "ODATAIN")], net(inst, "OFB"))
+            if dly is not None:
+                cur = net(dly, "DATAOUT")
+            buf = driven_by([(k, v[0]) for k, v in BUFFERS.items() if v[0]], cur)
+            pad = pad_name(net(buf, BUFFERS[buf["kind"]][2])) if buf else None
+            if pad is None:
+                continue
+            mapping.append((inst["name"], "oserdes", pad, net(inst, "CLK") or ""))
+            if dly is not None:
+                mapping.append((dly["name"], "odelay", pad, ""))
+
+        elif inst["kind"] == "ISERDESE2":
+            delayed = inst["params"].get("IOBDELAY", '"NONE"').strip('"') in ("IFD", "BOTH")
+            cur = net(inst, "DDLY" if delayed else "D")
+            dly = None
+            for cand in instances:
+                if cand["kind"] == "IDELAYE2" and net(cand, "DATAOUT") == cur:
+                    dly = cand
+                    cur = net(cand, "IDATAIN")
+                    break
+            pad = None
+            for cand in instances:
+                ports = BUFFERS.get(cand["kind"])
+                if ports and ports[1] and net(cand, ports[1]) == cur:
+                    pad = pad_name(net(cand, ports[2]))
+                    break
+            if pad is None:
+                continue
+            mapping.append((inst["name"], "iserdes", pad, net(inst, "CLK") or ""))
+            if dly is not None:
+                mapping.append((dly["name"], "idelay", pad, ""))
+
+    return mapping
+
+# Main --------------------------------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("netlist", help="Generated PHY netlist (phy_core.v)")
+    parser.add_argument("output",  help="Map file to write")
+    args = parser.parse_args()
+
+    with open(args.netlist) as f:
+        instances, alias = parse(f.read())
+
+    mapping = trace(instances, alias)
+    if not mapping:
+        raise SystemExit("No serdes connected to ddram_* pads in {}".format(args.netlist))
+
+    with open(args.output, "w") as f:
+        for entry in mapping:
+            f.write(" ".join(e for e in entry if e) + "\n")
+
+    print("Mapped {} serdes/delay instances to pads".format(len(mapping)))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,454 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_channel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "sim_phy_csr.h"
+#include "sim_report.h"
+#ifdef SIM_SAVABLE
+#include "sim_snapshot.h"
+#endif
+
+namespace {
+
+// Timing at 1200 MT/s (sys_clk_freq 75 MHz, src/standalone-dfi.yml, CK
+// from the 600 MHz sys8x clock) and the 78 ps taps of IDELAYE2/ODELAYE2
+// with a 200 MHz reference clock
+const double UI_PS         = 1e6 / 1200.0;
+const double TAP_PS        = 1e6 / (200.0 * 64);
+
+// Without a configured eye the data is valid over 60 % of the bit
+const double EYE_UI        = 0.6;
+
+// Ideal read sampling point in the middle of the tap range, write leveling
+// transition 8 taps after the reset value
+const double READ_CENTER   = 16 * TAP_PS;
+const double WRLVL_OFFSET  = -8 * TAP_PS;
+
+// Settings of a YAML block, each of delay/jitter/eye may be missing
+struct Setting {
+    bool   has[3] = { false, false, false };
+    double value[3];
+};
+
+const char* const SETTING_KEYS[] = { "delay_ps", "jitter_ps", "eye_ps" };
+
+// Signal ranges of the group and single signal block names
+bool signal_range (const std::string& name, int& first, int& count) {
+    static const struct {
+        const char* name;
+        int         first;
+        int         count;
+    } groups[] = {
+        { "dqs", Channel::DQS, Channel::LANES   },
+        { "dmi", Channel::DMI, Channel::LANES   },
+        { "dq",  Channel::DQ,  Channel::DQ_BITS },
+        { "ca",  Channel::CA,  Channel::CA_BITS },
+        { "ck",  Channel::CK,  1                },
+        { "cs",  Channel::CS,  1                },
+    };
+
+    for (const auto& group : groups) {
+        size_t len = strlen(group.name);
+        if (name.compare(0, len, group.name) != 0)
+            continue;
+        if (name.size() == len) {
+            first = group.first;
+            count = group.count;
+            return true;
+        }
+
+        char* end;
+        long index = strtol(name.c_str() + len, &end, 10);
+        if (*end != '\0' || index < 0 || index >= group.count)
+            return false;
+        first = group.first + index;
+        count = 1;
+        return true;
+    }
+    return false;
+}
+
+std::string trim (const std::string& str) {
+    size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+        return "";
+    size_t last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+
+bool parse_number (const std::string& str, double& value) {
+    char* end;
+    value = strtod(str.c_str(), &end);
+    return !str.empty() && trim(end).empty();
+}
+
+// Wraps x into [-period / 2, period / 2)
+double wrap (double x, double period) {
+    return x - period * std::floor(x / period + 0.5);
+}
+
+} // namespace
+
+Channel::Channel () :
+    m_ui          (UI_PS),
+    m_tap         (TAP_PS),
+    m_readCenter  (READ_CENTER),
+    m_wrlvlOffset (WRLVL_OFFSET),
+    m_state       (1),
+    m_phy         (NULL)
+{
+    for (Signal& sig : m_signals)
+        sig = { 0.0, 0.0, EYE_UI * UI_PS };
+}
+
+bool Channel::load (const std::string& path) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open '%s'\n", path.c_str());
+        return false;
+    }
+
+    // A flat subset of YAML: top level scalars and one level of blocks,
+    // written with indentation or as {key: value, ...}
+    std::map<std::string, Setting> blocks;
+    std::string block;
+    int         lineno = 0;
+    char        buf[512];
+
+    auto fail = [&](const char* msg) {
+        fprintf(stderr, "%s:%d: %s\n", path.c_str(), lineno, msg);
+        fclose(fp);
+        return false;
+    };
+
+    while (fgets(buf, sizeof(buf), fp)) {
+        lineno++;
+        std::string line = buf;
+        line = line.substr(0, line.find('#'));
+        if (trim(line).empty())
+            continue;
+
+        bool indented = line[0] == ' ' || line[0] == '\t';
+        size_t colon = line.find(':');
+        if (colon == std::string::npos)
+            return fail("expected 'key: value'");
+
+        std::string key   = trim(line.substr(0, colon));
+        std::string value = trim(line.substr(colon + 1));
+
+        // Block entries
+        std::vector<std::pair<std::string, std::string>> entries;
+        if (indented) {
+            if (block.empty())
+                return fail("unexpected indentation");
+            entries.push_back({ key, value });
+        } else if (value.empty() || value[0] == '{') {
+            int first, count;
+            if (key != "default" && !signal_range(key, first, count))
+                return fail("unknown signal");
+            block = key;
+            blocks[block];
+
+            if (!value.empty()) {
+                if (value.back() != '}')
+                    return fail("unterminated '{'");
+                std::string items = value.substr(1, value.size() - 2);
+                size_t pos = 0;
+                while (pos < items.size()) {
+                    size_t end = items.find(',', pos);
+                    if (end == std::string::npos)
+                        end = items.size();
+                    std::string item = items.substr(pos, end - pos);
+                    size_t sep = item.find(':');
+                    if (sep == std::string::npos)
+                        return fail("expected 'key: value'");
+                    entries.push_back({ trim(item.substr(0, sep)), trim(item.substr(sep + 1)) });
+                    pos = end + 1;
+                }
+                block.clear();
+            }
+        } else {
+            block.clear();
+
+            double number;
+            if (!parse_number(value, number))
+                return fail("expected a number");
+
+            if (key == "ui_ps")
+                m_ui = number;
+            else if (key == "tap_ps")
+                m_tap = number;
+            else if (key == "read_center_ps")
+                m_readCenter = number;
+            else if (key == "wrlvl_offset_ps")
+                m_wrlvlOffset = number;
+            else if (key == "seed")
+                m_state = (uint64_t)number;
+            else
+                return fail("unknown setting");
+            continue;
+        }
+
+        for (const auto& entry : entries) {
+            double number;
+            if (!parse_number(entry.second, number))
+                return fail("expected a number");
+
+            Setting& setting = blocks[indented ? block : key];
+            size_t i;
+            for (i = 0; i < 3; ++i)
+                if (entry.first == SETTING_KEYS[i])
+                    break;
+            if (i == 3)
+                return fail("expected delay_ps, jitter_ps or eye_ps");
+
+            setting.has[i]   = true;
+            setting.value[i] = number;
+        }
+    }
+    fclose(fp);
+
+    if (m_ui <= 0.0 || m_tap <= 0.0) {
+        fprintf(stderr, "%s: ui_ps and tap_ps must be positive\n", path.c_str());
+        return false;
+    }
+    if (m_state == 0)
+        m_state = 1;
+
+    // The default eye follows the configured unit interval
+    for (Signal& sig : m_signals)
+        sig = { 0.0, 0.0, EYE_UI * m_ui };
+
+    // Apply blocks from the least to the most specific one
+    for (int pass = 0; pass < 3; ++pass) {
+        for (const auto& it : blocks) {
+            int first = 0, count = SIGNALS;
+            if (it.first != "default")
+                signal_range(it.first, first, count);
+
+            int level = it.first == "default" ? 0 : (count > 1 ? 1 : 2);
+            if (level != pass)
+                continue;
+
+            for (int i = first; i < first + count; ++i) {
+                const Setting& setting = it.second;
+                if (setting.has[0]) m_signals[i].delay  = setting.value[0];
+                if (setting.has[1]) m_signals[i].jitter = setting.value[1];
+                if (setting.has[2]) m_signals[i].eye    = setting.value[2];
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Channel::random () {
+    // xorshift64
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 7;
+    m_state ^= m_state << 17;
+    return m_state & 1;
+}
+
+double Channel::jitter (int index) {
+    double peak = m_signals[index].jitter;
+    if (peak == 0.0)
+        return 0.0;
+
+    random();
+    return peak * ((double)(m_state >> 11) / (double)(1ull << 53) * 2.0 - 1.0);
+}
+
+int Channel::sample (int index, double t, double ui, bool& valid) {
+    const Signal& sig = m_signals[index];
+
+    double x = t - sig.delay + jitter(index);
+    int    k = (int)std::floor(x / ui + 0.5);
+
+    valid = std::fabs(x - k * ui) <= sig.eye / 2;
+    return k;
+}
+
+uint8_t Channel::ca (uint8_t ca) {
+    // CA is centered on the CK edge, the clock delay of the PHY moves both
+    double tck = 2 * m_ui;
+    double t   = m_signals[CK].delay + jitter(CK);
+
+    for (int i = 0; i < CA_BITS; ++i) {
+        bool valid;
+        if (sample(CA + i, t, tck, valid) != 0 || !valid)
+            ca = (ca & ~(1 << i)) | (random() << i);
+    }
+    return ca;
+}
+
+void Channel::burst (int lane, double t, uint16_t* data, uint8_t* dmi, int beats) {
+    uint16_t orig[BEATS];
+    uint8_t  origDmi[BEATS];
+    memcpy(orig,    data, beats * sizeof(*data));
+    memcpy(origDmi, dmi,  beats * sizeof(*dmi));
+
+    // Bits next to the burst are idle (low)
+    auto bit = [&](const uint16_t* word, int beat, int n) {
+        return beat >= 0 && beat < beats ? (word[beat] >> n) & 1 : 0;
+    };
+    auto bitDmi = [&](int beat) {
+        return beat >= 0 && beat < beats ? (origDmi[beat] >> lane) & 1 : 0;
+    };
+
+    for (int beat = 0; beat < beats; ++beat) {
+        for (int i = 0; i < 8; ++i) {
+            int  n = 8 * lane + i;
+            bool valid;
+            int  k = sample(DQ + n, t, m_ui, valid);
+            int  b = valid ? bit(orig, beat + k, n) : random();
+            data[beat] = (data[beat] & ~(1 << n)) | (b << n);
+        }
+
+        bool valid;
+        int  k = sample(DMI + lane, t, m_ui, valid);
+        int  b = valid ? bitDmi(beat + k) : random();
+        dmi[beat] = (dmi[beat] & ~(1 << lane)) | (b << lane);
+    }
+}
+
+void Channel::read (uint16_t* data, uint8_t* dmi, int beats) {
+    // Read data is sampled by the PHY after its IDELAY
+    for (int lane = 0; lane < LANES; ++lane) {
+        int    taps = m_phy ? m_phy->readDelay(lane) : 0;
+        double t    = taps * m_tap - m_readCenter;
+        burst(lane, t, data, dmi, beats);
+    }
+}
+
+void Channel::write (uint16_t* data, uint8_t* dmi, int beats) {
+    // Write data is sampled by DQS, both delayed by the ODELAYs of the PHY
+    for (int lane = 0; lane < LANES; ++lane) {
+        int    taps = m_phy ? m_phy->writeDqsDelay(lane) - m_phy->writeDelay(lane) : 0;
+        double t    = taps * m_tap + m_signals[DQS + lane].delay + jitter(DQS + lane);
+        burst(lane, t, data, dmi, beats);
+    }
+}
+
+bool Channel::leveling (int lane) {
+    // CK rises at phase 0, the clock delay of the PHY delays CK
+    int    taps  = m_phy ? m_phy->writeDqsDelay(lane) - m_phy->clockDelay() : 0;
+    double tck   = 2 * m_ui;
+    double phase = taps * m_tap + m_wrlvlOffset +
+                   m_signals[DQS + lane].delay + jitter(DQS + lane) -
+                   m_signals[CK].delay - jitter(CK);
+
+    phase -= tck * std::floor(phase / tck);
+    return phase < tck / 2;
+}
+
+#ifdef SIM_SAVABLE
+void Channel::save (VerilatedSerialize& os) const {
+    snapshot_put(os, m_state);
+}
+
+void Channel::restore (VerilatedDeserialize& is) {
+    snapshot_get(is, m_state);
+}
+#endif
+
+void Channel::dqWindow (int lane, double& center, double& half) const {
+    double lo = -INFINITY;
+    double hi = INFINITY;
+    for (int i = 0; i < 8; ++i) {
+        const Signal& sig = m_signals[DQ + 8 * lane + i];
+        double h = sig.eye / 2 - sig.jitter;
+        lo = std::max(lo, sig.delay - h);
+        hi = std::min(hi, sig.delay + h);
+    }
+    center = (lo + hi) / 2;
+    half   = (hi - lo) / 2;
+}
+
+void Channel::report (const Result& result, SimReport& report, FILE* fp) const {
+    int inEye = 0;
+    int total = 0;
+
+    fprintf(fp, "[sim] %-24s %8s %10s %12s %12s\n",
+            "Delay", "Picked", "Expected", "Error [ps]", "Margin [ps]");
+
+    auto add = [&](const char* name, int lane, int picked, double expected,
+                   double error, double margin) {
+        char metric[64];
+        snprintf(metric, sizeof(metric), "channel.%s.%d", name, lane);
+        report.metric(std::string(metric) + ".picked",    picked);
+        report.metric(std::string(metric) + ".expected",  expected);
+        report.metric(std::string(metric) + ".error_ps",  error);
+        report.metric(std::string(metric) + ".margin_ps", margin);
+
+        fprintf(fp, "[sim] %-24s %8d %10.1f %12.1f %12.1f\n",
+                (std::string(name) + "[" + std::to_string(lane) + "]").c_str(),
+                picked, expected, error, margin);
+
+        total++;
+        inEye += margin >= 0.0;
+    };
+
+    for (int lane = 0; lane < LANES; ++lane) {
+        double center, half;
+        dqWindow(lane, center, half);
+
+        // Read: tap * tap_ps - read_center_ps hits the common eye center,
+        // modulo whole bits which bitslip takes care of. The expected delay
+        // is the closest one to the picked.
+        if (result.readDelay[lane] >= 0) {
+            double error    = wrap(result.readDelay[lane] * m_tap - m_readCenter - center, m_ui);
+            double expected = result.readDelay[lane] - error / m_tap;
+            add("read_dq_delay", lane, result.readDelay[lane], expected,
+                error, half - std::fabs(error));
+        }
+
+        // Write: DQS (at its trained delay) hits the common eye center
+        if (result.writeDelay[lane] >= 0 && m_phy) {
+            int    dqs      = m_phy->writeDqsDelay(lane);
+            double dqsDelay = m_signals[DQS + lane].delay;
+            double error    = wrap((dqs - result.writeDelay[lane]) * m_tap + dqsDelay - center, m_ui);
+            double expected = result.writeDelay[lane] + error / m_tap;
+            add("write_dq_delay", lane, result.writeDelay[lane], expected,
+                error, half - std::fabs(error));
+        }
+    }
+
+    // Write leveling: DQS of every lane aligned with CK at the device
+    if (result.clockDelay >= 0 && m_phy) {
+        report.metric("channel.sdram_clock_delay", result.clockDelay);
+        fprintf(fp, "[sim] %-24s %8d\n", "sdram_clock_delay", result.clockDelay);
+
+        double tck = 2 * m_ui;
+        for (int lane = 0; lane < LANES; ++lane) {
+            double skew = (m_phy->writeDqsDelay(lane) - result.clockDelay) * m_tap + m_wrlvlOffset +
+                          m_signals[DQS + lane].delay - m_signals[CK].delay;
+            double error = wrap(skew, tck);
+            char metric[64];
+            snprintf(metric, sizeof(metric), "channel.dqs_ck_skew.%d.error_ps", lane);
+            report.metric(metric, error);
+            fprintf(fp, "[sim] %-24s %8s %10s %12.1f\n",
+                    ("dqs_ck_skew[" + std::to_string(lane) + "]").c_str(), "", "", error);
+        }
+    }
+
+    // Convergence: simulated cycles spent in firmware marked phases
+    uint64_t cycles = 0;
+    for (const SimReport::Phase& phase : report.phases())
+        cycles += phase.cycles;
+
+    report.metric("channel.delays_in_eye", inEye);
+    report.metric("channel.delays_total", total);
+    report.metric("channel.training_cycles", (double)cycles);
+    fprintf(fp, "[sim] %d of %d delays in the eye, training took %llu cycles\n",
+            inEye, total, (unsigned long long)cycles);
+}
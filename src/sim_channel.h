@@ -0,0 +1,123 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_CHANNEL_H
+#define SIM_CHANNEL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+class PhyCsr;
+class SimReport;
+class VerilatedDeserialize;
+class VerilatedSerialize;
+
+// Signal integrity of the DRAM channel. Every CA, CS, CK, DQ, DMI and DQS
+// line has a delay, a peak jitter and a data eye width, loaded from a YAML
+// file (see src/sim-channel.yml). The LPDDR4 model passes the data it drives and
+// captures through the channel, which combines the injected delays with
+// the delay taps the PHY currently applies (PhyCsr) and decides which bit
+// every receiver samples, or a random one outside of the eye. With the
+// word level serdes models (SerdesBus) the delays are applied to the pad
+// timing directly and only the signal parameters are used.
+//
+// All times are in ps. Sampling offsets are relative to the center of the
+// bit as sent.
+class Channel {
+public:
+
+    // Signal indices
+    enum {
+        DQ      = 0,
+        DQS     = 16,
+        DMI     = 18,
+        CA      = 20,
+        CK      = 26,
+        CS      = 27,
+        SIGNALS = 28,
+    };
+
+    static const int DQ_BITS = 16;
+    static const int LANES   = 2;
+    static const int CA_BITS = 6;
+    static const int BEATS   = 64;  // Longest burst read() and write() take
+
+    struct Signal {
+        double delay;
+        double jitter;
+        double eye;
+    };
+
+    // Firmware training results, -1 if unknown
+    struct Result {
+        int readDelay[LANES];
+        int writeDelay[LANES];
+        int clockDelay;
+    };
+
+    Channel ();
+
+    // Reads the configuration. Returns false and prints the reason on
+    // failure.
+    bool load (const std::string& path);
+
+    void setPhy (const PhyCsr* phy) { m_phy = phy; }
+
+    const Signal& signal (int index) const { return m_signals[index]; }
+
+    double ui  () const { return m_ui; }
+    double tap () const { return m_tap; }
+
+    // Random jitter of a signal within its peak value and a random bit
+    double jitter (int index);
+    bool   random ();
+
+#ifdef SIM_SAVABLE
+    // PRNG state for snapshots, the rest is loaded again
+    void save    (VerilatedSerialize& os) const;
+    void restore (VerilatedDeserialize& is);
+#endif
+
+    // CA bits sampled by the device on a CK edge
+    uint8_t ca (uint8_t ca);
+
+    // Transform a burst in place into what the receiver captures, dmi
+    // holds the per lane DMI bits of every beat
+    void read  (uint16_t* data, uint8_t* dmi, int beats);
+    void write (uint16_t* data, uint8_t* dmi, int beats);
+
+    // CK level seen by the DQS of a lane in write leveling mode
+    bool leveling (int lane);
+
+    // Compares training results with the delays that center the sampling
+    // points in the injected eyes and adds the metrics to the report
+    void report (const Result& result, SimReport& report, FILE* fp) const;
+
+private:
+
+    // Sampling at offset t of a signal with the given unit interval.
+    // Returns the shift of the sampled bit relative to the nominal one and
+    // sets valid when the sampling point falls in the eye.
+    int    sample (int index, double t, double ui, bool& valid);
+
+    // Passes a burst through the DQ and DMI receivers of a lane
+    void   burst (int lane, double t, uint16_t* data, uint8_t* dmi, int beats);
+
+    // Center of the common eye of the DQs of a lane relative to their
+    // nominal sampling point and its half width
+    void dqWindow (int lane, double& center, double& half) const;
+
+    Signal   m_signals[SIGNALS];
+
+    double   m_ui;
+    double   m_tap;
+    double   m_readCenter;      // Read delay centering an ideal eye
+    double   m_wrlvlOffset;     // DQS to CK skew at the device with no delays
+    uint64_t m_state;           // PRNG
+
+    const PhyCsr* m_phy;
+};
+
+#endif // SIM_CHANNEL_H
@@ -0,0 +1,84 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_clocks.h"
+
+#include <numeric>
+
+namespace {
+
+struct ClockDef {
+    uint8_t  mask;
+    uint32_t period;    // In ticks
+    int32_t  phase;     // Rising edge offset in ticks
+};
+
+// Clock domains of the PHY CRG (src/crg.py) relative to sys:
+//  - sys2x  at 2x,
+//  - sys8x  at 8x with -45 degrees phase shift,
+//  - idelay at 200MHz, 8/3x of the 75MHz sys clock.
+const ClockDef CLOCKS[] = {
+    { ClockSchedule::CLK_SYS,    ClockSchedule::TICKS_PER_SYS,      0 },
+    { ClockSchedule::CLK_SYS2X,  ClockSchedule::TICKS_PER_SYS / 2,  0 },
+    { ClockSchedule::CLK_SYS8X,  ClockSchedule::TICKS_PER_SYS / 8, -1 },
+    { ClockSchedule::CLK_IDELAY, ClockSchedule::TICKS_PER_SYS * 3 / 8, 0 },
+};
+
+uint8_t levels_at (int64_t t, uint8_t clocks) {
+    uint8_t levels = 0;
+    for (const ClockDef& clk : CLOCKS) {
+        if (!(clocks & clk.mask))
+            continue;
+        int64_t pos = (t - clk.phase) % clk.period;
+        if (pos < 0)
+            pos += clk.period;
+        if (pos < clk.period / 2)
+            levels |= clk.mask;
+    }
+    return levels;
+}
+
+} // namespace
+
+ClockSchedule::ClockSchedule (uint8_t clocks) :
+    m_hyperperiod (1),
+    m_base        (0),
+    m_index       (0)
+{
+    for (const ClockDef& clk : CLOCKS)
+        if (clocks & clk.mask)
+            m_hyperperiod = std::lcm(m_hyperperiod, clk.period);
+
+    // Record every tick at which any of the clocks changes its level. The
+    // first entry is tick 0 so the model starts from defined clock levels.
+    m_edges.push_back({0, levels_at(0, clocks)});
+    for (uint32_t t = 1; t < m_hyperperiod; ++t) {
+        uint8_t levels = levels_at(t, clocks);
+        if (levels != m_edges.back().levels)
+            m_edges.push_back({t, levels});
+    }
+}
+
+uint64_t ClockSchedule::next (uint8_t* levels) {
+    const Edge& edge = m_edges[m_index];
+    uint64_t time = m_base + edge.time;
+
+    *levels = edge.levels;
+
+    if (++m_index == m_edges.size()) {
+        m_index = 0;
+        m_base += m_hyperperiod;
+    }
+
+    return time;
+}
+
+uint64_t ClockSchedule::position () const {
+    return (m_base / m_hyperperiod) * m_edges.size() + m_index;
+}
+
+void ClockSchedule::seek (uint64_t position) {
+    m_base  = (position / m_edges.size()) * m_hyperperiod;
+    m_index = position % m_edges.size();
+}
@@ -0,0 +1,57 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_CLOCKS_H
+#define SIM_CLOCKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Clock edge schedule for models built with SIM_CPP_CLOCKS. All clock
+// domains are described by their period and phase in ticks. The schedule
+// holds one entry per tick at which any clock changes within a
+// hyperperiod, so the testbench evaluates the model only on real edges.
+// Clocks left out of the schedule stay low.
+class ClockSchedule {
+public:
+
+    // Ticks per sys clock period
+    static const uint32_t TICKS_PER_SYS = 64;
+
+    enum {
+        CLK_SYS    = 1 << 0,
+        CLK_SYS2X  = 1 << 1,
+        CLK_SYS8X  = 1 << 2,
+        CLK_IDELAY = 1 << 3,
+        CLK_ALL    = 0x0F,
+    };
+
+    struct Edge {
+        uint32_t time;      // Offset within the hyperperiod
+        uint8_t  levels;    // Clock levels after the edge, CLK_* bitmask
+    };
+
+    explicit ClockSchedule (uint8_t clocks = CLK_ALL);
+
+    // Advances to the next edge. Returns its absolute time in ticks and
+    // the clock levels to apply.
+    uint64_t next (uint8_t* levels);
+
+    size_t size () const { return m_edges.size(); }
+
+    // Number of edges applied so far. Used to save and restore the
+    // schedule along with the model state.
+    uint64_t position () const;
+    void seek (uint64_t position);
+
+private:
+
+    std::vector<Edge> m_edges;
+    uint32_t          m_hyperperiod;
+    uint64_t          m_base;
+    size_t            m_index;
+};
+
+#endif // SIM_CLOCKS_H
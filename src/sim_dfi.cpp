@@ -0,0 +1,434 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_dfi.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "sim_lpddr4.h"
+#include "sim_phy_csr.h"
+#include "Vsim_top__Dpi.h"
+#ifdef SIM_SAVABLE
+#include "sim_snapshot.h"
+#endif
+
+namespace {
+
+// Size of the CSR address space of the PHY in bytes, see rtl/phy.sv
+const uint32_t CSR_SPACE = 1u << 12;
+
+// DFI injector command register bits
+enum {
+    DFII_COMMAND_CS     = 0x01,
+    DFII_COMMAND_WE     = 0x02,
+    DFII_COMMAND_CAS    = 0x04,
+    DFII_COMMAND_RAS    = 0x08,
+    DFII_COMMAND_WRDATA = 0x10,
+    DFII_COMMAND_RDDATA = 0x20,
+};
+
+// DFI injector control register bits
+enum {
+    DFII_CONTROL_SEL     = 0x01,
+    DFII_CONTROL_CKE     = 0x02,
+    DFII_CONTROL_ODT     = 0x04,
+    DFII_CONTROL_RESET_N = 0x08,
+};
+
+// LPDDR4 command encodings of CA[4:0] in the first cycle (CS high), the
+// same as decoded by Lpddr4
+enum {
+    CMD_MPC  = 0x00,
+    CMD_PRE  = 0x10,
+    CMD_REF  = 0x08,
+    CMD_WR1  = 0x04,
+    CMD_RD1  = 0x02,
+    CMD_CAS2 = 0x12,
+    CMD_MRW1 = 0x06,
+    CMD_MRW2 = 0x16,
+};
+
+// CK cycles after a command before the next one, covers the postamble of
+// the last burst
+const int IDLE_CYCLES = 4;
+
+// Bitslip that passes the data of an ideal channel unchanged. Each step
+// moves the 16 beats of a sys clock cycle the PHY sends or receives by one
+// beat on the DQ lines, the range is centered so that whole bit shifts of
+// the channel can be undone in both directions.
+const int BITSLIP_CENTER = PhyCsr::BITSLIPS / 2 - 1;
+
+// Idle beats on either side of a burst in the data stream passed through
+// the channel, covers the bitslips and the delay lines
+const int EDGE_BEATS = Lpddr4::BURST;
+const int STREAM     = Lpddr4::BURST + 2 * EDGE_BEATS;
+static_assert(STREAM <= Channel::BEATS, "Stream too long for the channel");
+
+inline uint8_t bits (uint32_t v, int lsb, int n) {
+    return (v >> lsb) & ((1u << n) - 1);
+}
+
+// First cycle of a command with CA5 as the operand bit
+inline uint8_t first (uint8_t cmd, int op) {
+    return cmd | (op << 5);
+}
+
+} // namespace
+
+DfiModel::DfiModel () :
+    m_control (0)
+{
+    memset(m_phases, 0, sizeof(m_phases));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool DfiModel::load (const std::string& path) {
+    static const struct {
+        const char* name;
+        Reg         reg;
+    } names[] = {
+        { "sdram_dfii_control",        DFII_CONTROL       },
+        { "ddrphy_wlevel_strobe",      WLEVEL_STROBE      },
+        { "ddrphy_wdly_dqs_inc_count", WDLY_DQS_INC_COUNT },
+        { "ddrphy_half_sys8x_taps",    HALF_SYS8X_TAPS    },
+    };
+
+    static const struct {
+        const char* name;
+        Reg         reg;
+    } phase_names[] = {
+        { "command",       PI_COMMAND       },
+        { "command_issue", PI_COMMAND_ISSUE },
+        { "address",       PI_ADDRESS       },
+        { "baddress",      PI_BADDRESS      },
+        { "wrdata",        PI_WRDATA        },
+        { "rddata",        PI_RDDATA        },
+    };
+
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open '%s'\n", path.c_str());
+        return false;
+    }
+
+    Channel* ch = channel();
+
+    // Lines of interest: csr_register,<name>,<address>,<size>,<mode>. All
+    // registers are kept, the ones without a model read back what was
+    // written.
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "csr_register,", 13) != 0)
+            continue;
+
+        char* name = line + 13;
+        char* addr = strchr(name, ',');
+        if (addr == NULL)
+            continue;
+        *addr++ = '\0';
+
+        char*    end;
+        uint32_t byte = strtoul(addr, &end, 0) & (CSR_SPACE - 1);
+        int      size = *end == ',' ? atoi(end + 1) : 1;
+
+        Register reg = { OTHER, 0, 0 };
+        for (const auto& n : names)
+            if (strcmp(name, n.name) == 0)
+                reg.reg = n.reg;
+
+        // Writable in the PHY, resets to a quarter of tCK in taps
+        if (reg.reg == HALF_SYS8X_TAPS)
+            reg.value = (uint32_t)std::floor(ch->ui() / 2 / ch->tap());
+
+        int  phase;
+        char field[32];
+        if (sscanf(name, "sdram_dfii_pi%d_%31s", &phase, field) == 2 &&
+            phase >= 0 && phase < PHASES) {
+            for (const auto& n : phase_names)
+                if (strcmp(field, n.name) == 0)
+                    reg = { n.reg, phase, 0 };
+        }
+
+        for (int i = 0; i < std::max(size, 1); ++i)
+            m_regs[(byte >> 2) + i] = reg;
+    }
+    fclose(fp);
+
+    if (m_regs.empty()) {
+        fprintf(stderr, "No CSRs in '%s'\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+Channel* DfiModel::channel () {
+    // Without an injected channel the device sees an ideal one, which
+    // still follows the delays set in the PHY. Data bursts are passed
+    // through the channel here along with the idle beats around them,
+    // which the bitslips of the PHY select from.
+    Lpddr4& device = lpddr4_model();
+    if (device.channel() == NULL) {
+        m_ideal.setPhy(&phy_csr());
+        device.setChannel(&m_ideal);
+    }
+    device.setChannelData(false);
+    return device.channel();
+}
+
+uint32_t DfiModel::read (uint32_t addr) {
+    auto it = m_regs.find(addr);
+    if (it == m_regs.end())
+        return 0;
+
+    const Register& reg = it->second;
+    switch (reg.reg) {
+    case DFII_CONTROL:
+        return m_control;
+    case PI_COMMAND:
+        return m_phases[reg.phase].command;
+    case PI_ADDRESS:
+        return m_phases[reg.phase].address;
+    case PI_BADDRESS:
+        return m_phases[reg.phase].baddress;
+    case PI_WRDATA:
+        return m_phases[reg.phase].wrdata;
+    case PI_RDDATA:
+        return m_phases[reg.phase].rddata;
+
+    case WDLY_DQS_INC_COUNT: {
+        // Tap count of the lowest selected module
+        uint32_t sel = phy_csr().delaySelect();
+        for (int i = 0; i < PhyCsr::MAX_MODULES; ++i)
+            if (sel & (1u << i))
+                return phy_csr().writeDqsDelay(i);
+        return 0;
+    }
+
+    default:
+        return reg.value;
+    }
+}
+
+void DfiModel::write (uint32_t addr, uint32_t data) {
+    auto it = m_regs.find(addr);
+    if (it == m_regs.end())
+        return;
+
+    m_stats.writes++;
+
+    Register& reg = it->second;
+    reg.value = data;
+
+    switch (reg.reg) {
+    case DFII_CONTROL:
+        m_control = data;
+        // Reset and CKE reach the device with the next CK edge
+        cycle(false, 0);
+        break;
+    case PI_COMMAND:
+        m_phases[reg.phase].command = data;
+        break;
+    case PI_COMMAND_ISSUE:
+        issue(reg.phase);
+        break;
+    case PI_ADDRESS:
+        m_phases[reg.phase].address = data;
+        break;
+    case PI_BADDRESS:
+        m_phases[reg.phase].baddress = data;
+        break;
+    case PI_WRDATA:
+        m_phases[reg.phase].wrdata = data;
+        break;
+    case WLEVEL_STROBE:
+        levelingStrobe();
+        break;
+    default:
+        break;
+    }
+}
+
+void DfiModel::cycle (bool cs, uint8_t ca) {
+    Lpddr4& device = lpddr4_model();
+    bool cke     = m_control & DFII_CONTROL_CKE;
+    bool reset_n = m_control & DFII_CONTROL_RESET_N;
+
+    device.clock(true,  cs,    ca, cke, reset_n);
+    device.clock(false, false, 0,  cke, reset_n);
+}
+
+void DfiModel::command (uint8_t h, uint8_t l) {
+    cycle(true, h);
+    cycle(false, l);
+}
+
+void DfiModel::issue (int phase) {
+    const Phase& p = m_phases[phase];
+    m_stats.commands++;
+
+    // The injector drives the DFI only with SEL clear
+    if (!(p.command & DFII_COMMAND_CS) || (m_control & DFII_CONTROL_SEL))
+        return;
+
+    bool     ras  = p.command & DFII_COMMAND_RAS;
+    bool     cas  = p.command & DFII_COMMAND_CAS;
+    bool     we   = p.command & DFII_COMMAND_WE;
+    uint8_t  bank = p.baddress & 7;
+    uint32_t a    = p.address;
+    int      ab   = bits(a, 10, 1);
+
+    // LiteDRAM LPDDR4 DFI encoding
+    if (ras && cas && we) {
+        // MRW, MA in the bank address, OP in the address
+        command(first(CMD_MRW1, bits(a, 7, 1)), p.baddress & 0x3F);
+        command(first(CMD_MRW2, bits(a, 6, 1)), bits(a, 0, 6));
+    } else if (ras && cas) {
+        // ZQC, MPC with the opcode in the address
+        command(first(CMD_MPC, bits(a, 6, 1)), bits(a, 0, 6));
+    } else if (ras && we) {
+        command(first(CMD_PRE, ab), bank);
+    } else if (ras) {
+        command(0x01 | bits(a, 12, 4) << 2,
+                bank | bits(a, 11, 1) << 3 | bits(a, 10, 1) << 4 | bits(a, 16, 1) << 5);
+        command(0x03 | bits(a, 6, 4) << 2, bits(a, 0, 6));
+    } else if (cas) {
+        command(we ? CMD_WR1 : CMD_RD1, bank | bits(a, 9, 1) << 4 | ab << 5);
+        command(first(CMD_CAS2, bits(a, 8, 1)), bits(a, 2, 6));
+        if (we)
+            writeBurst();
+        else
+            readBurst();
+    } else if (we) {
+        command(first(CMD_REF, ab), bank);
+    }
+
+    for (int i = 0; i < IDLE_CYCLES; ++i)
+        cycle(false, 0);
+}
+
+void DfiModel::writeBurst () {
+    Lpddr4& device = lpddr4_model();
+
+    // The device captures from the first DQS edge WL + 0.5 tCK after the
+    // rising CK edge of CAS-2, half a cycle of which has passed
+    for (int i = 0; i < device.writeLatency(); ++i)
+        cycle(false, 0);
+
+    // Phase data holds the beats of both DQS edges, rising in the low half.
+    // A higher write bitslip sends the beats of a lane earlier.
+    uint16_t stream[STREAM] = {};
+    uint8_t  dmi[STREAM]    = {};
+    for (int lane = 0; lane < Lpddr4::LANES; ++lane) {
+        int slip = phy_csr().writeBitslip(lane) - BITSLIP_CENTER;
+        for (int beat = 0; beat < Lpddr4::BURST; ++beat) {
+            uint32_t word = m_phases[beat / 2].wrdata >> (beat % 2 ? 16 : 0);
+            stream[EDGE_BEATS + beat - slip] |= word & (0xFF << (8 * lane));
+        }
+    }
+
+    // The device samples the beats after the channel on its DQS edges
+    channel()->write(stream, dmi, STREAM);
+    for (int beat = 0; beat < Lpddr4::BURST; ++beat)
+        for (int lane = 0; lane < Lpddr4::LANES; ++lane)
+            device.strobe(lane, beat % 2 == 0, stream[EDGE_BEATS + beat] >> (8 * lane), false);
+    m_stats.bursts++;
+}
+
+void DfiModel::readBurst () {
+    Lpddr4&  device = lpddr4_model();
+    uint16_t stream[STREAM] = {};
+    uint8_t  dmi[STREAM]    = {};
+    int      count = 0;
+
+    // Read data shows up RL cycles after CAS-2, one beat per half cycle
+    // while DQS is driven along with DQ
+    bool cke     = m_control & DFII_CONTROL_CKE;
+    bool reset_n = m_control & DFII_CONTROL_RESET_N;
+    for (int half = 0; half < 2 * (device.readLatency() + 2) + Lpddr4::BURST; ++half) {
+        device.clock(half % 2 == 0, false, 0, cke, reset_n);
+        if (device.dqsOe() && device.dqOe() && count < Lpddr4::BURST)
+            stream[EDGE_BEATS + count++] = device.dq();
+    }
+
+    // The PHY samples the beats after the channel, a higher read bitslip
+    // takes the beats of a lane from later in the stream
+    channel()->read(stream, dmi, STREAM);
+    uint16_t beats[Lpddr4::BURST] = {};
+    for (int lane = 0; lane < Lpddr4::LANES; ++lane) {
+        int slip = phy_csr().readBitslip(lane) - BITSLIP_CENTER;
+        for (int beat = 0; beat < Lpddr4::BURST; ++beat)
+            beats[beat] |= stream[EDGE_BEATS + beat + slip] & (0xFF << (8 * lane));
+    }
+
+    for (int p = 0; p < PHASES; ++p)
+        m_phases[p].rddata = beats[2 * p] | (uint32_t)beats[2 * p + 1] << 16;
+    m_stats.bursts++;
+}
+
+void DfiModel::levelingStrobe () {
+    Lpddr4& device = lpddr4_model();
+
+    // A single DQS pulse per lane, the feedback is returned on all beats
+    for (int lane = 0; lane < Lpddr4::LANES; ++lane) {
+        device.strobe(lane, true,  0, false);
+        device.strobe(lane, false, 0, false);
+    }
+
+    uint32_t dq = device.dqOe() ? device.dq() : 0;
+    for (Phase& p : m_phases)
+        p.rddata = dq | dq << 16;
+}
+
+#ifdef SIM_SAVABLE
+void DfiModel::save (VerilatedSerialize& os) const {
+    snapshot_put(os, m_phases);
+    snapshot_put(os, m_control);
+    snapshot_put(os, m_stats);
+    m_ideal.save(os);
+
+    snapshot_put(os, (uint64_t)m_regs.size());
+    for (const auto& entry : m_regs) {
+        snapshot_put(os, entry.first);
+        snapshot_put(os, entry.second.value);
+    }
+}
+
+void DfiModel::restore (VerilatedDeserialize& is) {
+    snapshot_get(is, m_phases);
+    snapshot_get(is, m_control);
+    snapshot_get(is, m_stats);
+    m_ideal.restore(is);
+
+    // Values of registers the loaded map does not have are dropped
+    uint64_t regs;
+    snapshot_get(is, regs);
+    for (uint64_t i = 0; i < regs; ++i) {
+        uint32_t addr, value;
+        snapshot_get(is, addr);
+        snapshot_get(is, value);
+        auto it = m_regs.find(addr);
+        if (it != m_regs.end())
+            it->second.value = value;
+    }
+}
+#endif
+
+// Instance and DPI glue ---------------------------------------------------------------------------
+
+DfiModel& dfi_model () {
+    static DfiModel model;
+    return model;
+}
+
+int sim_dfi_csr_read (int addr) {
+    return dfi_model().read(addr);
+}
+
+void sim_dfi_csr_write (int addr, int data) {
+    dfi_model().write(addr, data);
+}
@@ -0,0 +1,118 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_DFI_H
+#define SIM_DFI_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "sim_channel.h"
+
+// Transaction level model of phy_core for the DFI build (make
+// verilator-build-dfi). rtl/sim/sim_dfi_phy.sv stands in for the generated
+// netlist and forwards its CSR bus here, so no serdes, delay line or sys8x
+// clock is simulated. The model implements the CSRs of the DFI injector
+// (sdram_dfii_*) and the status registers of the PHY, the delay and
+// bitslip settings are kept by PhyCsr from the writes monitored in
+// sim_top.sv. Every command issued through the injector is translated into
+// the LPDDR4 command encoding and clocked into the device (Lpddr4) at
+// once: write bursts are strobed in with the data of all phases and read
+// bursts are collected into the read data registers. Delays, eyes and the
+// write leveling feedback come from the channel of the device, which
+// applies the PHY settings analytically. The data of a burst is passed
+// through the channel with idle beats around it, the read and write
+// bitslips of each lane pick the beats that reach the phases or the
+// device, so a delay past a bit is corrected by the bitslip like in the
+// PHY.
+//
+// Only the software controlled DFI of the injector is modelled, the DFI
+// ports of phy_core are left idle.
+class DfiModel {
+public:
+
+    static const int PHASES = 8;
+
+    struct Stats {
+        uint64_t writes;        // CSR writes
+        uint64_t commands;      // Issued through the injector
+        uint64_t bursts;        // Read and write data bursts
+    };
+
+    DfiModel ();
+
+    // Reads register addresses from csr.csv. Returns false and prints the
+    // reason on failure. The channel of the device has to be set before.
+    bool load (const std::string& path);
+
+    // CSR bus access, addr is the word address within the PHY
+    uint32_t read  (uint32_t addr);
+    void     write (uint32_t addr, uint32_t data);
+
+    const Stats& stats () const { return m_stats; }
+
+#ifdef SIM_SAVABLE
+    // Register values and phases for snapshots, the register map is
+    // loaded again
+    void save    (VerilatedSerialize& os) const;
+    void restore (VerilatedDeserialize& is);
+#endif
+
+private:
+
+    enum Reg {
+        OTHER,
+        DFII_CONTROL,
+        PI_COMMAND,
+        PI_COMMAND_ISSUE,
+        PI_ADDRESS,
+        PI_BADDRESS,
+        PI_WRDATA,
+        PI_RDDATA,
+        WLEVEL_STROBE,
+        WDLY_DQS_INC_COUNT,
+        HALF_SYS8X_TAPS,
+    };
+
+    struct Register {
+        Reg      reg;
+        int      phase;
+        uint32_t value;
+    };
+
+    struct Phase {
+        uint32_t command;
+        uint32_t address;
+        uint32_t baddress;
+        uint32_t wrdata;
+        uint32_t rddata;
+    };
+
+    // Channel the device passes commands and data through
+    Channel* channel ();
+
+    // Translates the command of a phase into CA cycles
+    void issue (int phase);
+
+    // One CK cycle, CS and CA are sampled on the rising edge
+    void cycle (bool cs, uint8_t ca);
+    void command (uint8_t h, uint8_t l);
+
+    void writeBurst ();
+    void readBurst ();
+    void levelingStrobe ();
+
+    std::unordered_map<uint32_t, Register> m_regs;
+
+    Phase    m_phases[PHASES];
+    uint32_t m_control;
+    Channel  m_ideal;
+    Stats    m_stats;
+};
+
+// Instance driven by sim_dfi_phy.sv
+DfiModel& dfi_model ();
+
+#endif // SIM_DFI_H
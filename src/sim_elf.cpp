@@ -0,0 +1,115 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_elf.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <elf.h>
+
+bool ElfImage::load (const std::string& path) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open '%s'\n", path.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> file;
+    uint8_t buf[4096];
+    size_t  len;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+        file.insert(file.end(), buf, buf + len);
+    fclose(fp);
+
+    Elf32_Ehdr ehdr;
+    if (file.size() < sizeof(ehdr) ||
+        memcmp(file.data(), ELFMAG, SELFMAG) != 0 ||
+        file[EI_CLASS] != ELFCLASS32 ||
+        file[EI_DATA]  != ELFDATA2LSB) {
+        fprintf(stderr, "'%s' is not a 32-bit little-endian ELF file\n", path.c_str());
+        return false;
+    }
+    memcpy(&ehdr, file.data(), sizeof(ehdr));
+
+    if (ehdr.e_machine != EM_RISCV || ehdr.e_type != ET_EXEC) {
+        fprintf(stderr, "'%s' is not a RISC-V executable\n", path.c_str());
+        return false;
+    }
+
+    entry = ehdr.e_entry;
+    segments.clear();
+
+    for (unsigned i = 0; i < ehdr.e_phnum; ++i) {
+        Elf32_Phdr phdr;
+        size_t offs = ehdr.e_phoff + (size_t)i * ehdr.e_phentsize;
+        if (offs + sizeof(phdr) > file.size()) {
+            fprintf(stderr, "'%s' is truncated\n", path.c_str());
+            return false;
+        }
+        memcpy(&phdr, file.data() + offs, sizeof(phdr));
+
+        if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0)
+            continue;
+        if ((size_t)phdr.p_offset + phdr.p_filesz > file.size()) {
+            fprintf(stderr, "'%s' is truncated\n", path.c_str());
+            return false;
+        }
+
+        Segment seg;
+        seg.data.assign(phdr.p_memsz, 0);
+        std::copy(file.begin() + phdr.p_offset,
+                  file.begin() + phdr.p_offset + phdr.p_filesz,
+                  seg.data.begin());
+
+        // Initialized data is stored at its load address and copied by the
+        // startup code. Place it at its run address as well so that startup
+        // code which does not copy it works too.
+        seg.addr = phdr.p_vaddr;
+        if (phdr.p_vaddr != phdr.p_paddr && phdr.p_filesz != 0) {
+            Segment lma;
+            lma.addr = phdr.p_paddr;
+            lma.data.assign(seg.data.begin(), seg.data.begin() + phdr.p_filesz);
+            segments.push_back(lma);
+        }
+
+        segments.push_back(seg);
+    }
+
+    // Symbols are optional, a stripped file only lacks them
+    symbols.clear();
+    for (unsigned i = 0; i < ehdr.e_shnum; ++i) {
+        Elf32_Shdr shdr;
+        size_t offs = ehdr.e_shoff + (size_t)i * ehdr.e_shentsize;
+        if (offs + sizeof(shdr) > file.size())
+            break;
+        memcpy(&shdr, file.data() + offs, sizeof(shdr));
+
+        if (shdr.sh_type != SHT_SYMTAB || shdr.sh_link >= ehdr.e_shnum)
+            continue;
+
+        Elf32_Shdr strtab;
+        offs = ehdr.e_shoff + (size_t)shdr.sh_link * ehdr.e_shentsize;
+        if (offs + sizeof(strtab) > file.size())
+            break;
+        memcpy(&strtab, file.data() + offs, sizeof(strtab));
+
+        if ((size_t)shdr.sh_offset + shdr.sh_size > file.size() ||
+            (size_t)strtab.sh_offset + strtab.sh_size > file.size())
+            break;
+
+        for (size_t s = 0; s + sizeof(Elf32_Sym) <= shdr.sh_size; s += sizeof(Elf32_Sym)) {
+            Elf32_Sym sym;
+            memcpy(&sym, file.data() + shdr.sh_offset + s, sizeof(sym));
+            if (ELF32_ST_TYPE(sym.st_info) != STT_OBJECT || sym.st_name >= strtab.sh_size)
+                continue;
+
+            const char* name = (const char*)file.data() + strtab.sh_offset + sym.st_name;
+            size_t len = strnlen(name, strtab.sh_size - sym.st_name);
+            symbols[std::string(name, len)] = { sym.st_value, sym.st_size };
+        }
+    }
+
+    return true;
+}
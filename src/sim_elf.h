@@ -0,0 +1,37 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_ELF_H
+#define SIM_ELF_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Loadable contents of a 32-bit RISC-V ELF executable
+struct ElfImage {
+
+    struct Segment {
+        uint32_t             addr;
+        std::vector<uint8_t> data;  // Zero-filled up to the memory size
+    };
+
+    struct Symbol {
+        uint32_t addr;
+        uint32_t size;
+    };
+
+    uint32_t             entry = 0;
+    std::vector<Segment> segments;
+
+    // Data objects from the symbol table, by name
+    std::map<std::string, Symbol> symbols;
+
+    // Reads PT_LOAD segments and data symbols of the file. Returns false and prints the
+    // reason on failure.
+    bool load (const std::string& path);
+};
+
+#endif // SIM_ELF_H
@@ -0,0 +1,145 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_host.h"
+
+HostChannel::HostChannel () :
+    m_fp         (NULL),
+    m_dumpPrefix ("dump"),
+    m_arg        (0),
+    m_dumpCount  (0),
+    m_finished   (false),
+    m_exitCode   (0),
+    m_trapped    (false),
+    m_mcause     (0),
+    m_mepc       (0)
+{
+}
+
+HostChannel::~HostChannel () {
+    close();
+}
+
+bool HostChannel::open (const char* path) {
+    close();
+    m_fp = fopen(path, "wb");
+    return m_fp != NULL;
+}
+
+void HostChannel::close () {
+    fflush(stdout);
+    if (m_fp != NULL) {
+        fclose(m_fp);
+        m_fp = NULL;
+    }
+}
+
+bool HostChannel::write (uint32_t addr, uint32_t data, uint8_t mask) {
+
+    if (addr == ADDR_ARG) {
+        m_arg = data;
+        return true;
+    }
+
+    if (addr != ADDR_CMD)
+        return false;
+
+    uint8_t  cmd = data >> 24;
+    uint32_t arg = data & 0xFFFFFF;
+
+    // Byte stores carry no command
+    if (mask != 0xF || cmd == CMD_LEGACY) {
+        uint8_t c = data & 0xFF;
+        if (c == 0x00 || c >= 0x80)
+            finish(c == 0x00 ? 0 : 1);
+        else
+            putc(c);
+        return true;
+    }
+
+    switch (cmd) {
+    case CMD_PUTC:
+        putc(arg & 0xFF);
+        break;
+    case CMD_EXIT:
+        finish(arg);
+        break;
+    case CMD_TRAP:
+        m_trapped = true;
+        m_mcause  = arg;
+        m_mepc    = m_arg;
+        finish(1);
+        break;
+    case CMD_MARK:
+    case CMD_DUMP:
+        // Memory cannot be read back while the model is being evaluated
+        m_deferred.push_back({cmd, m_arg, arg});
+        break;
+    default:
+        fprintf(stderr, "[sim] Unknown host command 0x%02X\n", cmd);
+        break;
+    }
+
+    return true;
+}
+
+void HostChannel::tick () {
+    if (m_deferred.empty())
+        return;
+
+    for (const Deferred& req : m_deferred) {
+        if (req.cmd == CMD_MARK)
+            mark(req.arg, req.addr);
+        else
+            dump(req.addr, req.arg);
+    }
+    m_deferred.clear();
+}
+
+void HostChannel::putc (uint8_t c) {
+    fputc(c, stdout);
+    if (m_fp != NULL)
+        fputc(c, m_fp);
+}
+
+void HostChannel::finish (int code) {
+    m_finished = true;
+    m_exitCode = code;
+}
+
+void HostChannel::mark (uint32_t phase, uint32_t name) {
+    std::string str;
+    if (name != 0 && m_readByte) {
+        for (uint8_t c; str.size() < 256 && (c = m_readByte(name + str.size())) != 0;)
+            str.push_back((char)c);
+    }
+
+    fflush(stdout);
+    if (m_onMark)
+        m_onMark(phase, str);
+}
+
+void HostChannel::dump (uint32_t addr, uint32_t size) {
+    if (!m_readByte) {
+        fprintf(stderr, "[sim] Memory dump requested but memory is not accessible\n");
+        return;
+    }
+
+    std::string path = m_dumpPrefix + "_" + std::to_string(m_dumpCount++) + ".bin";
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "[sim] Cannot open '%s'\n", path.c_str());
+        return;
+    }
+
+    std::vector<uint8_t> buf(size);
+    for (uint32_t i = 0; i < size; ++i)
+        buf[i] = m_readByte(addr + i);
+
+    fwrite(buf.data(), 1, buf.size(), fp);
+    fclose(fp);
+
+    fprintf(stderr, "[sim] Dumped %u bytes from 0x%08X to '%s'\n",
+            size, addr, path.c_str());
+}
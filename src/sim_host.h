@@ -0,0 +1,109 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_HOST_H
+#define SIM_HOST_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Host channel of the simulation. The firmware talks to the testbench by
+// writing to two RAM words at the top of the memory (see fw/sim_host.h):
+//
+//  - HOST_ARG (0x801FFFF8) holds an argument for the next command,
+//  - HOST_CMD (0x801FFFFC) executes a command given in bits [31:24] with
+//    a 24-bit argument in bits [23:0]:
+//      CMD_PUTC - write the byte arg[7:0] to stdout,
+//      CMD_EXIT - finish the simulation with exit code arg,
+//      CMD_MARK - start phase arg, for timing. HOST_ARG holds the byte
+//                 address of its NUL-terminated name or 0. Phase 0 ends
+//                 the current phase without starting a new one,
+//      CMD_DUMP - write arg bytes of RAM starting at the byte address in
+//                 HOST_ARG to a binary file,
+//      CMD_TRAP - report an unhandled exception with mcause arg and mepc
+//                 in HOST_ARG, finishes the simulation.
+//
+// Byte stores and command 0 to HOST_CMD keep the original semantics: 0x00
+// and 0x80 - 0xFF finish the simulation, other values are written to
+// stdout.
+class HostChannel {
+public:
+
+    enum Command {
+        CMD_LEGACY = 0x00,
+        CMD_PUTC   = 0x01,
+        CMD_EXIT   = 0x02,
+        CMD_MARK   = 0x03,
+        CMD_DUMP   = 0x04,
+        CMD_TRAP   = 0x05,
+    };
+
+    // Word addresses on the RAM bus
+    static const uint32_t ADDR_CMD = 0x1FFFF;
+    static const uint32_t ADDR_ARG = 0x1FFFE;
+
+    // Reads a byte of ROM or RAM at the given CPU address
+    typedef std::function<uint8_t (uint32_t)> ReadByte;
+
+    // Called on phase marks
+    typedef std::function<void (uint32_t, const std::string&)> MarkHandler;
+
+    HostChannel  ();
+    ~HostChannel ();
+
+    // Opens the file console output is written to, besides stdout
+    bool open (const char* path);
+    void close ();
+
+    void setReadByte (ReadByte read) { m_readByte = read; }
+    void setMarkHandler (MarkHandler handler) { m_onMark = handler; }
+    void setDumpPrefix (const std::string& prefix) { m_dumpPrefix = prefix; }
+
+    // Handles a RAM write. Returns true if it was addressed to the channel.
+    bool write (uint32_t addr, uint32_t data, uint8_t mask);
+
+    // Called once per sys clock cycle, outside of the model evaluation.
+    // Executes deferred commands that need to access the memory.
+    void tick ();
+
+    bool finished () const { return m_finished; }
+    int  exitCode () const { return m_exitCode; }
+
+    // Set when the firmware finished with CMD_TRAP
+    bool     trapped () const { return m_trapped; }
+    uint32_t mcause  () const { return m_mcause; }
+    uint32_t mepc    () const { return m_mepc; }
+
+private:
+
+    // Command executed outside of the model evaluation
+    struct Deferred {
+        uint8_t  cmd;
+        uint32_t addr;
+        uint32_t arg;
+    };
+
+    void putc (uint8_t c);
+    void finish (int code);
+    void mark (uint32_t phase, uint32_t name);
+    void dump (uint32_t addr, uint32_t size);
+
+    FILE*                 m_fp;
+    ReadByte              m_readByte;
+    MarkHandler           m_onMark;
+    std::string           m_dumpPrefix;
+    uint32_t              m_arg;
+    uint32_t              m_dumpCount;
+    std::vector<Deferred> m_deferred;
+    bool                  m_finished;
+    int                   m_exitCode;
+    bool                  m_trapped;
+    uint32_t              m_mcause;
+    uint32_t              m_mepc;
+};
+
+#endif // SIM_HOST_H
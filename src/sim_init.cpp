@@ -0,0 +1,63 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_init.h"
+
+#include <cstdio>
+
+InitTrigger::InitTrigger (uint64_t start, uint32_t count, uint64_t hold) :
+    m_start (start),
+    m_count (count),
+    m_hold  (hold),
+    m_state { count ? WAIT_START : FINISHED, 0, 0 }
+{
+}
+
+bool InitTrigger::tick (uint64_t cycle, bool init_done) {
+    switch (m_state.phase) {
+    case WAIT_START:
+        if (cycle < m_start)
+            return false;
+        fprintf(stderr, "[sim] Init trigger asserted at cycle %llu\n",
+                (unsigned long long)cycle);
+        m_state.phase = ASSERTED;
+        m_state.since = cycle;
+        return true;
+
+    case ASSERTED:
+        if (!init_done)
+            return true;
+        m_durations.push_back(cycle - m_state.since);
+        fprintf(stderr, "[sim] Init done at cycle %llu, %llu cycles after the trigger\n",
+                (unsigned long long)cycle, (unsigned long long)(cycle - m_state.since));
+        m_state.phase = HOLD;
+        m_state.since = cycle;
+        return true;
+
+    case HOLD:
+        if (cycle - m_state.since < m_hold)
+            return true;
+        m_state.done++;
+        m_state.phase = RELEASED;
+        m_state.since = cycle;
+        return false;
+
+    case RELEASED:
+        if (init_done)
+            return false;
+        if (m_state.done >= m_count) {
+            m_state.phase = FINISHED;
+            return false;
+        }
+        fprintf(stderr, "[sim] Init trigger asserted at cycle %llu\n",
+                (unsigned long long)cycle);
+        m_state.phase = ASSERTED;
+        m_state.since = cycle;
+        return true;
+
+    case FINISHED:
+    default:
+        return false;
+    }
+}
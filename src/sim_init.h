@@ -0,0 +1,60 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_INIT_H
+#define SIM_INIT_H
+
+#include <cstdint>
+#include <vector>
+
+// DFI init handshake of the memory controller. Asserts the init trigger of
+// the SoC (dfi_init_start_i) at a given cycle, waits for the firmware to
+// report init done, holds the trigger for a number of cycles and releases
+// it. Once the firmware has cleared init done again the trigger is asserted
+// again until the requested number of inits is reached. Clocked once per
+// sys clock cycle.
+class InitTrigger {
+public:
+
+    enum Phase : uint32_t {
+        WAIT_START,     // Before the first trigger
+        ASSERTED,       // Trigger high, waiting for init done
+        HOLD,           // Init done, trigger still high
+        RELEASED,       // Trigger low, waiting for init done to clear
+        FINISHED,       // All inits done
+    };
+
+    // Plain state, saved in snapshots
+    struct State {
+        Phase    phase;
+        uint32_t done;      // Completed inits
+        uint64_t since;     // Cycle the current phase started at
+    };
+
+    // count of 0 never asserts the trigger
+    InitTrigger (uint64_t start, uint32_t count, uint64_t hold);
+
+    // Returns the level of the trigger for the next cycle
+    bool tick (uint64_t cycle, bool init_done);
+
+    // True after the last init, never without a trigger
+    bool finished () const { return m_count != 0 && m_state.phase == FINISHED; }
+
+    // Cycles from the trigger to init done of every completed init
+    const std::vector<uint64_t>& durations () const { return m_durations; }
+
+    const State& state () const { return m_state; }
+    void setState (const State& state) { m_state = state; }
+
+private:
+
+    uint64_t m_start;
+    uint32_t m_count;
+    uint64_t m_hold;
+    State    m_state;
+
+    std::vector<uint64_t> m_durations;
+};
+
+#endif // SIM_INIT_H
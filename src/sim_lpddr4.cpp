@@ -0,0 +1,570 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_lpddr4.h"
+
+#include <cstdarg>
+#include <cstring>
+
+#include "sim_channel.h"
+#ifdef SIM_SAVABLE
+#include "sim_snapshot.h"
+#endif
+
+namespace {
+
+// Command encodings of CA[4:0] in the first cycle (CS high), CA0 low
+enum {
+    CMD_MPC   = 0x00,
+    CMD_PRE   = 0x10,
+    CMD_REF   = 0x08,
+    CMD_SRE   = 0x18,
+    CMD_WR1   = 0x04,
+    CMD_SRX   = 0x14,
+    CMD_MWR1  = 0x0C,
+    CMD_RD1   = 0x02,
+    CMD_CAS2  = 0x12,
+    CMD_MRW1  = 0x06,
+    CMD_MRW2  = 0x16,
+    CMD_MRR1  = 0x0E,
+};
+
+// Multi purpose command opcodes
+enum {
+    MPC_RD_FIFO   = 0x41,
+    MPC_RD_DQ_CAL = 0x43,
+    MPC_WR_FIFO   = 0x47,
+};
+
+// Depth of the training FIFO
+const size_t FIFO_DEPTH = 5;
+
+// Read preamble length in half cycles (static, 2 tCK)
+const int READ_PREAMBLE = 4;
+
+// Read latency (DBI off / on) and write latency (set A / B) by MR2 code
+const int RL_TABLE[2][8]  = { { 6, 10, 14, 20, 24, 28, 32, 36 },
+                              { 6, 12, 16, 22, 28, 32, 36, 40 } };
+const int WL_TABLE[2][8]  = { { 4,  6,  8, 10, 12, 14, 16, 18 },
+                              { 4,  8, 12, 18, 22, 26, 30, 34 } };
+
+// Maximum number of reported protocol violations
+const uint64_t MAX_ERRORS = 16;
+
+inline int bit (uint8_t v, int n) {
+    return (v >> n) & 1;
+}
+
+} // namespace
+
+Lpddr4::Lpddr4 () :
+    m_log         (NULL),
+    m_channel     (NULL),
+    m_channelData (true)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    reset();
+}
+
+void Lpddr4::reset () {
+    m_ck      = false;
+    m_half    = 0;
+    m_dq      = 0;
+    m_dqOe    = 0;
+    m_dqs     = 0;
+    m_dqsOe   = 0;
+    m_dmi     = 0;
+    m_csHigh  = false;
+    m_caHigh  = 0;
+    m_pending = NONE;
+
+    memset(m_wrlvl, 0, sizeof(m_wrlvl));
+    memset(m_mr, 0, sizeof(m_mr));
+    memset(m_open, 0, sizeof(m_open));
+
+    m_mr[5]  = 0xFF;    // Manufacturer ID: Micron
+    m_mr[8]  = 0x00;    // S16, 4Gb per channel, x16
+    m_mr[32] = 0x5A;    // DQ calibration patterns A and B
+    m_mr[40] = 0x3C;
+
+    m_fifo.clear();
+    m_reads.clear();
+    m_writes.clear();
+}
+
+int Lpddr4::readLatency () const {
+    return RL_TABLE[bit(m_mr[3], 6)][m_mr[2] & 7];
+}
+
+int Lpddr4::writeLatency () const {
+    return WL_TABLE[bit(m_mr[2], 6)][(m_mr[2] >> 3) & 7];
+}
+
+uint64_t Lpddr4::key (int bank, uint32_t row, uint32_t col) const {
+    return ((uint64_t)bank << 32) | ((uint64_t)row << 10) | (col & ~(uint32_t)(BURST - 1));
+}
+
+void Lpddr4::error (const char* fmt, ...) {
+    if (++m_stats.errors > MAX_ERRORS)
+        return;
+
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "[lpddr4] Cycle %llu: ", (unsigned long long)(m_half / 2));
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+
+void Lpddr4::clock (bool ck, bool cs, uint8_t ca, bool cke, bool reset_n) {
+    if (!reset_n) {
+        reset();
+        return;
+    }
+
+    m_ck = ck;
+    m_half++;
+
+    // Commands are captured on rising edges, the first cycle with CS high
+    if (ck && cke) {
+        if (m_channel)
+            ca = m_channel->ca(ca);
+
+        if (m_csHigh) {
+            command(m_caHigh, ca & 0x3F);
+            m_csHigh = false;
+        } else if (cs) {
+            m_caHigh = ca & 0x3F;
+            m_csHigh = true;
+        }
+    }
+
+    updateDrive();
+}
+
+void Lpddr4::command (uint8_t h, uint8_t l) {
+    // Activate, CA0 high
+    if (bit(h, 0)) {
+        if (!bit(h, 1)) {
+            m_bank = l & 7;
+            m_row  = (bit(h, 2) << 12) | (bit(h, 3) << 13) | (bit(h, 4) << 14) | (bit(h, 5) << 15) |
+                     (bit(l, 3) << 11) | (bit(l, 4) << 10) | (bit(l, 5) << 16);
+            m_pending = ACT1;
+            return;
+        }
+
+        if (m_pending != ACT1) {
+            error("ACT-2 without ACT-1");
+            return;
+        }
+        m_pending = NONE;
+
+        uint32_t row = m_row | (bit(h, 2) << 6) | (bit(h, 3) << 7) | (bit(h, 4) << 8) |
+                       (bit(h, 5) << 9) | (l & 0x3F);
+        if (m_open[m_bank])
+            error("ACT to open bank %d", m_bank);
+
+        m_open[m_bank]    = true;
+        m_openRow[m_bank] = row;
+        m_stats.act++;
+
+        if (m_log)
+            fprintf(m_log, "%llu ACT bank %d row 0x%X\n", (unsigned long long)(m_half / 2), m_bank, row);
+        return;
+    }
+
+    uint8_t  cmd = h & 0x1E;
+    bool     op  = bit(h, 5);
+
+    // CAS-2 completes reads, writes and data MPCs
+    if (cmd == CMD_CAS2) {
+        uint32_t col = (op << 8) | ((l & 0x3F) << 2);
+        cas2(col);
+        return;
+    }
+
+    if (m_pending != NONE && !(m_pending == MRW1 && cmd == CMD_MRW2))
+        error("Command 0x%02X interrupts a two-part command", h);
+
+    switch (cmd) {
+    case CMD_MPC:
+        m_op = (op << 6) | (l & 0x3F);
+        m_stats.mpc++;
+        if (m_op == MPC_RD_FIFO || m_op == MPC_RD_DQ_CAL || m_op == MPC_WR_FIFO)
+            m_pending = MPC1;
+        else
+            m_pending = NONE;
+        break;
+
+    case CMD_PRE:
+        if (op) {
+            memset(m_open, 0, sizeof(m_open));
+        } else {
+            m_open[l & 7] = false;
+        }
+        m_stats.pre++;
+        m_pending = NONE;
+        break;
+
+    case CMD_REF:
+        if (op) {
+            for (int i = 0; i < BANKS; ++i)
+                if (m_open[i])
+                    error("REFab with bank %d open", i);
+        }
+        m_stats.ref++;
+        m_pending = NONE;
+        break;
+
+    case CMD_SRE:
+    case CMD_SRX:
+        m_pending = NONE;
+        break;
+
+    case CMD_WR1:
+    case CMD_MWR1:
+    case CMD_RD1:
+        m_bank    = l & 7;
+        m_col9    = bit(l, 4);
+        m_autoPre = bit(l, 5);
+        m_pending = cmd == CMD_RD1 ? RD1 : (cmd == CMD_WR1 ? WR1 : MWR1);
+        break;
+
+    case CMD_MRW1:
+        m_ma      = l & 0x3F;
+        m_op      = op << 7;
+        m_pending = MRW1;
+        break;
+
+    case CMD_MRW2:
+        if (m_pending != MRW1) {
+            error("MRW-2 without MRW-1");
+            break;
+        }
+        m_op |= (op << 6) | (l & 0x3F);
+        m_mr[m_ma] = m_op;
+        m_stats.mrw++;
+        m_pending = NONE;
+
+        if (m_log)
+            fprintf(m_log, "%llu MRW MR%d 0x%02X\n", (unsigned long long)(m_half / 2), m_ma, m_op);
+
+        // Leaving write leveling stops the feedback
+        if (m_ma == 2 && !writeLeveling()) {
+            memset(m_wrlvl, 0, sizeof(m_wrlvl));
+            m_dqOe = 0;
+        }
+        break;
+
+    case CMD_MRR1:
+        m_ma      = l & 0x3F;
+        m_pending = MRR1;
+        break;
+
+    default:
+        error("Unsupported command 0x%02X", h);
+        m_pending = NONE;
+        break;
+    }
+}
+
+void Lpddr4::cas2 (uint32_t col) {
+    Pending pending = m_pending;
+    m_pending = NONE;
+
+    uint64_t tick = m_half / 2;
+
+    switch (pending) {
+    case RD1: {
+        col |= m_col9 << 9;
+        m_stats.rd++;
+        if (!m_open[m_bank]) {
+            error("RD from closed bank %d", m_bank);
+            return;
+        }
+
+        auto it = m_mem.find(key(m_bank, m_openRow[m_bank], col));
+        Burst data = {};
+        if (it != m_mem.end())
+            data = it->second;
+        scheduleRead(data);
+
+        if (m_log)
+            fprintf(m_log, "%llu RD bank %d row 0x%X col 0x%X\n", (unsigned long long)tick,
+                    m_bank, m_openRow[m_bank], col);
+        if (m_autoPre)
+            m_open[m_bank] = false;
+        break;
+    }
+
+    case WR1:
+    case MWR1: {
+        col |= m_col9 << 9;
+        m_stats.wr++;
+        if (!m_open[m_bank]) {
+            error("WR to closed bank %d", m_bank);
+            return;
+        }
+
+        Transfer xfer = {};
+        xfer.start  = m_half + 2 * writeLatency() + 1;
+        xfer.masked = pending == MWR1;
+        xfer.bank   = m_bank;
+        xfer.row    = m_openRow[m_bank];
+        xfer.col    = col;
+        m_writes.push_back(xfer);
+
+        if (m_log)
+            fprintf(m_log, "%llu WR bank %d row 0x%X col 0x%X\n", (unsigned long long)tick,
+                    m_bank, m_openRow[m_bank], col);
+        if (m_autoPre)
+            m_open[m_bank] = false;
+        break;
+    }
+
+    case MRR1: {
+        Burst data;
+        data.fill(m_mr[m_ma]);
+        scheduleRead(data);
+        m_stats.mrr++;
+        break;
+    }
+
+    case MPC1:
+        if (m_op == MPC_WR_FIFO) {
+            Transfer xfer = {};
+            xfer.start = m_half + 2 * writeLatency() + 1;
+            xfer.fifo  = true;
+            m_writes.push_back(xfer);
+        } else if (m_op == MPC_RD_FIFO) {
+            Burst data = {};
+            if (!m_fifo.empty()) {
+                data = m_fifo.front();
+                m_fifo.pop_front();
+            }
+            scheduleRead(data);
+        } else {
+            // Patterns from MR32 (beats 0-7) and MR40 (beats 8-15), inverted
+            // per DQ by MR15 (lower byte) and MR20 (upper byte)
+            uint16_t invert = m_mr[15] | (m_mr[20] << 8);
+            Burst data;
+            for (int i = 0; i < BURST; ++i) {
+                int b = i < 8 ? bit(m_mr[32], i) : bit(m_mr[40], i - 8);
+                data[i] = (b ? 0xFFFF : 0x0000) ^ invert;
+            }
+            scheduleRead(data);
+        }
+        break;
+
+    default:
+        error("CAS-2 without a preceding command");
+        break;
+    }
+}
+
+void Lpddr4::scheduleRead (const Burst& data) {
+    // Called on the rising CK edge of CAS-2, data starts RL cycles later
+    Transfer xfer = {};
+    xfer.start = m_half + 2 * readLatency();
+    xfer.data  = data;
+
+    // Read DBI inverts bytes with more than four ones
+    bool dbi = bit(m_mr[3], 6);
+    for (int i = 0; i < BURST; ++i) {
+        xfer.dmi[i] = 0;
+        for (int lane = 0; lane < LANES && dbi; ++lane) {
+            uint8_t byte = xfer.data[i] >> (8 * lane);
+            if (__builtin_popcount(byte) > 4) {
+                xfer.data[i] ^= 0xFF << (8 * lane);
+                xfer.dmi[i]  |= 1 << lane;
+            }
+        }
+    }
+
+    if (m_channel && m_channelData)
+        m_channel->read(xfer.data.data(), xfer.dmi, BURST);
+
+    m_reads.push_back(xfer);
+}
+
+void Lpddr4::strobe (int lane, bool rise, uint8_t dq, bool dmi) {
+    if (lane < 0 || lane >= LANES)
+        return;
+
+    // Write leveling: CK sampled on rising DQS edges is returned on DQ
+    if (writeLeveling()) {
+        if (rise) {
+            bool level = m_channel ? m_channel->leveling(lane) : m_ck;
+            m_wrlvl[lane] = level ? 0xFF : 0x00;
+        }
+        updateDrive();
+        return;
+    }
+
+    if (m_writes.empty())
+        return;
+
+    // Data is captured on DQS edges starting from the first rising one
+    // after WL + 0.5 tCK, earlier edges belong to the preamble
+    Transfer& xfer = m_writes.front();
+    int& beats = xfer.beats[lane];
+    if (m_half < xfer.start || beats >= BURST || (beats == 0 && !rise))
+        return;
+
+    xfer.data[beats] = (xfer.data[beats] & ~(0xFF << (8 * lane))) | (dq << (8 * lane));
+    xfer.dmi[beats] |= dmi << lane;
+    beats++;
+
+    for (int i = 0; i < LANES; ++i)
+        if (xfer.beats[i] < BURST)
+            return;
+
+    commitWrite(xfer);
+    m_writes.pop_front();
+}
+
+void Lpddr4::commitWrite (Transfer xfer) {
+    if (m_channel && m_channelData)
+        m_channel->write(xfer.data.data(), xfer.dmi, BURST);
+
+    if (xfer.fifo) {
+        if (m_fifo.size() >= FIFO_DEPTH)
+            m_fifo.pop_front();
+        m_fifo.push_back(xfer.data);
+        return;
+    }
+
+    bool dbi = bit(m_mr[3], 7);
+    bool dm  = !bit(m_mr[13], 5);
+
+    Burst& mem = m_mem[key(xfer.bank, xfer.row, xfer.col)];
+    for (int i = 0; i < BURST; ++i) {
+        for (int lane = 0; lane < LANES; ++lane) {
+            uint16_t mask = 0xFF << (8 * lane);
+            uint16_t data = xfer.data[i] & mask;
+            bool     dmi  = bit(xfer.dmi[i], lane);
+
+            // DMI means inversion with write DBI, mask otherwise
+            if (dbi && dmi)
+                data = ~data & mask;
+            else if (!dbi && dm && xfer.masked && dmi)
+                continue;
+
+            mem[i] = (mem[i] & ~mask) | data;
+        }
+    }
+}
+
+void Lpddr4::updateDrive () {
+    // Drop finished read bursts
+    while (!m_reads.empty() && m_half >= m_reads.front().start + BURST + 1)
+        m_reads.pop_front();
+
+    m_dq    = 0;
+    m_dqOe  = 0;
+    m_dqs   = 0;
+    m_dqsOe = 0;
+    m_dmi   = 0;
+
+    if (!m_reads.empty()) {
+        const Transfer& xfer = m_reads.front();
+        if (m_half + READ_PREAMBLE >= xfer.start) {
+            // Preamble and postamble drive DQS low
+            m_dqsOe = (1 << LANES) - 1;
+            if (m_half >= xfer.start && m_half < xfer.start + BURST) {
+                int beat = m_half - xfer.start;
+                m_dq   = xfer.data[beat];
+                m_dmi  = xfer.dmi[beat];
+                m_dqOe = (1 << LANES) - 1;
+                m_dqs  = beat % 2 == 0 ? (1 << LANES) - 1 : 0;
+            }
+        }
+        return;
+    }
+
+    if (writeLeveling()) {
+        m_dqOe = (1 << LANES) - 1;
+        for (int lane = 0; lane < LANES; ++lane)
+            m_dq |= m_wrlvl[lane] << (8 * lane);
+    }
+}
+
+#ifdef SIM_SAVABLE
+void Lpddr4::save (VerilatedSerialize& os) const {
+    snapshot_put(os, m_ck);
+    snapshot_put(os, m_half);
+    snapshot_put(os, m_dq);
+    snapshot_put(os, m_dqOe);
+    snapshot_put(os, m_dqs);
+    snapshot_put(os, m_dqsOe);
+    snapshot_put(os, m_dmi);
+    snapshot_put(os, m_wrlvl);
+    snapshot_put(os, m_csHigh);
+    snapshot_put(os, m_caHigh);
+    snapshot_put(os, m_pending);
+    snapshot_put(os, m_bank);
+    snapshot_put(os, m_row);
+    snapshot_put(os, m_col9);
+    snapshot_put(os, m_ma);
+    snapshot_put(os, m_op);
+    snapshot_put(os, m_autoPre);
+    snapshot_put(os, m_mr);
+    snapshot_put(os, m_open);
+    snapshot_put(os, m_openRow);
+    snapshot_put(os, m_stats);
+
+    snapshot_put(os, (uint64_t)m_mem.size());
+    for (const auto& entry : m_mem) {
+        snapshot_put(os, entry.first);
+        snapshot_put(os, entry.second);
+    }
+    snapshot_put_all(os, m_fifo);
+    snapshot_put_all(os, m_reads);
+    snapshot_put_all(os, m_writes);
+}
+
+void Lpddr4::restore (VerilatedDeserialize& is) {
+    snapshot_get(is, m_ck);
+    snapshot_get(is, m_half);
+    snapshot_get(is, m_dq);
+    snapshot_get(is, m_dqOe);
+    snapshot_get(is, m_dqs);
+    snapshot_get(is, m_dqsOe);
+    snapshot_get(is, m_dmi);
+    snapshot_get(is, m_wrlvl);
+    snapshot_get(is, m_csHigh);
+    snapshot_get(is, m_caHigh);
+    snapshot_get(is, m_pending);
+    snapshot_get(is, m_bank);
+    snapshot_get(is, m_row);
+    snapshot_get(is, m_col9);
+    snapshot_get(is, m_ma);
+    snapshot_get(is, m_op);
+    snapshot_get(is, m_autoPre);
+    snapshot_get(is, m_mr);
+    snapshot_get(is, m_open);
+    snapshot_get(is, m_openRow);
+    snapshot_get(is, m_stats);
+
+    uint64_t bursts;
+    snapshot_get(is, bursts);
+    m_mem.clear();
+    m_mem.reserve(bursts);
+    for (uint64_t i = 0; i < bursts; ++i) {
+        uint64_t key;
+        snapshot_get(is, key);
+        snapshot_get(is, m_mem[key]);
+    }
+    snapshot_get_all(is, m_fifo);
+    snapshot_get_all(is, m_reads);
+    snapshot_get_all(is, m_writes);
+}
+#endif
+
+// Device instance --------------------------------------------------------------------------------
+
+Lpddr4& lpddr4_model () {
+    static Lpddr4 model;
+    return model;
+}
@@ -0,0 +1,179 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_LPDDR4_H
+#define SIM_LPDDR4_H
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <unordered_map>
+
+class Channel;
+class VerilatedDeserialize;
+class VerilatedSerialize;
+
+// Behavioral model of a single channel x16 LPDDR4 device (MT53E256M16D1,
+// see src/standalone-dfi.yml). It is driven at the word level by SerdesBus,
+// which replays the pad timing of the serdes models, or by DfiModel in the
+// DFI build. The ddram_* pins of sim_top stay unconnected:
+//  - clock() is called on every CK edge with the CA bus, decodes commands
+//    on rising edges and updates the DQ/DQS drive for the next half cycle,
+//  - strobe() is called on every DQS edge driven by the controller to
+//    capture write data and to provide write leveling feedback.
+//
+// Supported are mode register writes and reads, activate, read, write,
+// masked write, precharge and refresh (bank state is tracked, refresh has
+// no effect on data), write leveling, the DQ calibration read and the
+// write/read training FIFO. Timing parameters other than the read and
+// write latency are not checked. Bursts are BL16 and aligned to 16
+// columns. With a Channel set, CA, read and write data and the write
+// leveling feedback see its delays, jitter and eyes. The data can be left
+// to the controller, which then passes it through the channel itself.
+class Lpddr4 {
+public:
+
+    static const int BANKS = 8;
+    static const int LANES = 2;     // Byte lanes
+    static const int BURST = 16;    // Beats
+
+    struct Stats {
+        uint64_t act;
+        uint64_t pre;
+        uint64_t ref;
+        uint64_t rd;
+        uint64_t wr;
+        uint64_t mrw;
+        uint64_t mrr;
+        uint64_t mpc;
+        uint64_t errors;    // Protocol violations
+    };
+
+    Lpddr4 ();
+
+    // Power-on state: mode registers at defaults, all banks closed
+    void reset ();
+
+    // CK edge
+    void clock (bool ck, bool cs, uint8_t ca, bool cke, bool reset_n);
+
+    // DQS edge of a byte lane driven by the controller
+    void strobe (int lane, bool rise, uint8_t dq, bool dmi);
+
+    // Pin drive of the device
+    uint16_t dq    () const { return m_dq; }
+    uint8_t  dqOe  () const { return m_dqOe; }     // Per lane
+    uint8_t  dqs   () const { return m_dqs; }      // Per lane, DQS_t level
+    uint8_t  dqsOe () const { return m_dqsOe; }    // Per lane
+    uint8_t  dmi   () const { return m_dmi; }      // Per lane
+
+    uint8_t      modeRegister (int ma) const { return m_mr[ma & 63]; }
+    bool         writeLeveling () const { return (m_mr[2] >> 7) & 1; }
+    const Stats& stats () const { return m_stats; }
+
+    // Logs decoded commands
+    void setLog (FILE* fp) { m_log = fp; }
+
+    // Programmed latencies in CK cycles
+    int readLatency () const;
+    int writeLatency () const;
+
+    // Passes commands and data through a non-ideal channel
+    void     setChannel (Channel* channel) { m_channel = channel; }
+    Channel* channel () const { return m_channel; }
+
+    // Without channel data, read and write bursts pass the device as they
+    // are driven and captured (DfiModel applies the channel)
+    void setChannelData (bool on) { m_channelData = on; }
+
+#ifdef SIM_SAVABLE
+    // Device state including the array contents, for snapshots. The log
+    // and the channel are not part of it.
+    void save    (VerilatedSerialize& os) const;
+    void restore (VerilatedDeserialize& is);
+#endif
+
+private:
+
+    typedef std::array<uint16_t, BURST> Burst;
+
+    // First cycle of two-part commands
+    enum Pending {
+        NONE,
+        ACT1,
+        WR1,
+        MWR1,
+        RD1,
+        MRW1,
+        MRR1,
+        MPC1,
+    };
+
+    // Data burst on the DQ bus, times in CK half cycles
+    struct Transfer {
+        uint64_t start;
+        Burst    data;
+        uint8_t  dmi[BURST];
+        // Writes
+        bool     masked;
+        bool     fifo;
+        int      beats[LANES];
+        // Target
+        int      bank;
+        uint32_t row;
+        uint32_t col;
+    };
+
+    void command (uint8_t h, uint8_t l);
+    void cas2 (uint32_t col);
+    void error (const char* fmt, ...);
+
+    uint64_t key (int bank, uint32_t row, uint32_t col) const;
+
+    void scheduleRead (const Burst& data);
+    void commitWrite (Transfer xfer);
+    void updateDrive ();
+
+    // Pins
+    bool     m_ck;
+    uint64_t m_half;        // CK half cycles since reset
+    uint16_t m_dq;
+    uint8_t  m_dqOe;
+    uint8_t  m_dqs;
+    uint8_t  m_dqsOe;
+    uint8_t  m_dmi;
+    uint8_t  m_wrlvl[LANES];
+
+    // Command decoding
+    bool     m_csHigh;
+    uint8_t  m_caHigh;
+    Pending  m_pending;
+    int      m_bank;
+    uint32_t m_row;
+    uint32_t m_col9;
+    uint8_t  m_ma;
+    uint8_t  m_op;
+    bool     m_autoPre;
+
+    // Device state
+    uint8_t  m_mr[64];
+    bool     m_open[BANKS];
+    uint32_t m_openRow[BANKS];
+
+    std::unordered_map<uint64_t, Burst> m_mem;
+    std::deque<Burst>                   m_fifo;
+    std::deque<Transfer>                m_reads;
+    std::deque<Transfer>                m_writes;
+
+    Stats    m_stats;
+    FILE*    m_log;
+    Channel* m_channel;
+    bool     m_channelData;
+};
+
+// Device instance driven by SerdesBus or DfiModel
+Lpddr4& lpddr4_model ();
+
+#endif // SIM_LPDDR4_H
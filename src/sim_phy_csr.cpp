@@ -0,0 +1,189 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_phy_csr.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Vsim_top__Dpi.h"
+#ifdef SIM_SAVABLE
+#include "sim_snapshot.h"
+#endif
+
+namespace {
+
+// Size of the CSR address space of the PHY in bytes, see rtl/phy.sv
+const uint32_t CSR_SPACE = 1u << 12;
+
+struct RegName {
+    const char* name;
+    int         reg;
+};
+
+} // namespace
+
+PhyCsr::PhyCsr () :
+    m_dlySel   (0),
+    m_wlevelEn (false),
+    m_cdly     (0),
+    m_writes   (0)
+{
+    memset(m_rdly,        0, sizeof(m_rdly));
+    memset(m_wdly,        0, sizeof(m_wdly));
+    memset(m_wdlyDqs,     0, sizeof(m_wdlyDqs));
+    memset(m_rdlyBitslip, 0, sizeof(m_rdlyBitslip));
+    memset(m_wdlyBitslip, 0, sizeof(m_wdlyBitslip));
+}
+
+bool PhyCsr::load (const std::string& path) {
+    static const RegName names[] = {
+        { "ddrphy_dly_sel",             DLY_SEL             },
+        { "ddrphy_wlevel_en",           WLEVEL_EN           },
+        { "ddrphy_cdly_rst",            CDLY_RST            },
+        { "ddrphy_cdly_inc",            CDLY_INC            },
+        { "ddrphy_rdly_dq_rst",         RDLY_DQ_RST         },
+        { "ddrphy_rdly_dq_inc",         RDLY_DQ_INC         },
+        { "ddrphy_rdly_dq_bitslip_rst", RDLY_DQ_BITSLIP_RST },
+        { "ddrphy_rdly_dq_bitslip",     RDLY_DQ_BITSLIP     },
+        { "ddrphy_wdly_dq_rst",         WDLY_DQ_RST         },
+        { "ddrphy_wdly_dq_inc",         WDLY_DQ_INC         },
+        { "ddrphy_wdly_dqs_rst",        WDLY_DQS_RST        },
+        { "ddrphy_wdly_dqs_inc",        WDLY_DQS_INC        },
+        { "ddrphy_wdly_dq_bitslip_rst", WDLY_DQ_BITSLIP_RST },
+        { "ddrphy_wdly_dq_bitslip",     WDLY_DQ_BITSLIP     },
+    };
+
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open '%s'\n", path.c_str());
+        return false;
+    }
+
+    // Lines of interest: csr_register,<name>,<address>,<size>,<mode>
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "csr_register,", 13) != 0)
+            continue;
+
+        char* name = line + 13;
+        char* addr = strchr(name, ',');
+        if (addr == NULL)
+            continue;
+        *addr++ = '\0';
+
+        for (const RegName& reg : names) {
+            if (strcmp(name, reg.name) == 0) {
+                uint32_t byte = strtoul(addr, NULL, 0) & (CSR_SPACE - 1);
+                m_regs[byte >> 2] = (Reg)reg.reg;
+            }
+        }
+    }
+    fclose(fp);
+
+    if (m_regs.empty()) {
+        fprintf(stderr, "No DDR PHY registers in '%s'\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+template <typename Op>
+void PhyCsr::selected (Op op) {
+    for (int i = 0; i < MAX_MODULES; ++i)
+        if (m_dlySel & (1u << i))
+            op(i);
+}
+
+void PhyCsr::write (uint32_t addr, uint32_t data) {
+    auto it = m_regs.find(addr);
+    if (it == m_regs.end())
+        return;
+
+    m_writes++;
+
+    // Strobe registers act on any write, counters wrap like the hardware
+    switch (it->second) {
+    case DLY_SEL:
+        m_dlySel = data;
+        break;
+    case WLEVEL_EN:
+        m_wlevelEn = data & 1;
+        break;
+    case CDLY_RST:
+        m_cdly = 0;
+        break;
+    case CDLY_INC:
+        m_cdly = (m_cdly + 1) % DELAYS;
+        break;
+    case RDLY_DQ_RST:
+        selected([&](int i) { m_rdly[i] = 0; });
+        break;
+    case RDLY_DQ_INC:
+        selected([&](int i) { m_rdly[i] = (m_rdly[i] + 1) % DELAYS; });
+        break;
+    case RDLY_DQ_BITSLIP_RST:
+        selected([&](int i) { m_rdlyBitslip[i] = 0; });
+        break;
+    case RDLY_DQ_BITSLIP:
+        selected([&](int i) { m_rdlyBitslip[i] = (m_rdlyBitslip[i] + 1) % BITSLIPS; });
+        break;
+    case WDLY_DQ_RST:
+        selected([&](int i) { m_wdly[i] = 0; });
+        break;
+    case WDLY_DQ_INC:
+        selected([&](int i) { m_wdly[i] = (m_wdly[i] + 1) % DELAYS; });
+        break;
+    case WDLY_DQS_RST:
+        selected([&](int i) { m_wdlyDqs[i] = 0; });
+        break;
+    case WDLY_DQS_INC:
+        selected([&](int i) { m_wdlyDqs[i] = (m_wdlyDqs[i] + 1) % DELAYS; });
+        break;
+    case WDLY_DQ_BITSLIP_RST:
+        selected([&](int i) { m_wdlyBitslip[i] = 0; });
+        break;
+    case WDLY_DQ_BITSLIP:
+        selected([&](int i) { m_wdlyBitslip[i] = (m_wdlyBitslip[i] + 1) % BITSLIPS; });
+        break;
+    }
+}
+
+#ifdef SIM_SAVABLE
+void PhyCsr::save (VerilatedSerialize& os) const {
+    snapshot_put(os, m_dlySel);
+    snapshot_put(os, m_wlevelEn);
+    snapshot_put(os, m_cdly);
+    snapshot_put(os, m_rdly);
+    snapshot_put(os, m_wdly);
+    snapshot_put(os, m_wdlyDqs);
+    snapshot_put(os, m_rdlyBitslip);
+    snapshot_put(os, m_wdlyBitslip);
+    snapshot_put(os, m_writes);
+}
+
+void PhyCsr::restore (VerilatedDeserialize& is) {
+    snapshot_get(is, m_dlySel);
+    snapshot_get(is, m_wlevelEn);
+    snapshot_get(is, m_cdly);
+    snapshot_get(is, m_rdly);
+    snapshot_get(is, m_wdly);
+    snapshot_get(is, m_wdlyDqs);
+    snapshot_get(is, m_rdlyBitslip);
+    snapshot_get(is, m_wdlyBitslip);
+    snapshot_get(is, m_writes);
+}
+#endif
+
+// Instance and DPI glue ---------------------------------------------------------------------------
+
+PhyCsr& phy_csr () {
+    static PhyCsr csr;
+    return csr;
+}
+
+void sim_phy_csr_write (int addr, int data) {
+    phy_csr().write(addr, data);
+}
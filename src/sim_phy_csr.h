@@ -0,0 +1,94 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_PHY_CSR_H
+#define SIM_PHY_CSR_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+class VerilatedDeserialize;
+class VerilatedSerialize;
+
+// Shadow of the delay and bitslip settings of the DDR PHY. It follows the
+// CSR writes of the firmware (monitored in sim_top.sv) so that the channel
+// model knows the delays the PHY applies. Register addresses are taken
+// from the csr.csv file generated along with phy_core.
+class PhyCsr {
+public:
+
+    static const int MAX_MODULES = 8;
+    static const int DELAYS      = 32;  // IDELAYE2/ODELAYE2 taps
+    static const int BITSLIPS    = 16;
+
+    PhyCsr ();
+
+    // Reads register addresses. Returns false and prints the reason on
+    // failure.
+    bool load (const std::string& path);
+
+    // CSR bus write, addr is the word address within the PHY
+    void write (uint32_t addr, uint32_t data);
+
+    // Current settings in taps / bits
+    int readDelay      (int module) const { return m_rdly[module]; }
+    int writeDelay     (int module) const { return m_wdly[module]; }
+    int writeDqsDelay  (int module) const { return m_wdlyDqs[module]; }
+    int readBitslip    (int module) const { return m_rdlyBitslip[module]; }
+    int writeBitslip   (int module) const { return m_wdlyBitslip[module]; }
+    int clockDelay     () const { return m_cdly; }
+    uint32_t delaySelect () const { return m_dlySel; }
+    bool writeLeveling () const { return m_wlevelEn; }
+
+    bool     loaded () const { return !m_regs.empty(); }
+    uint64_t writes () const { return m_writes; }
+
+#ifdef SIM_SAVABLE
+    // Settings for snapshots, the register map is loaded again
+    void save    (VerilatedSerialize& os) const;
+    void restore (VerilatedDeserialize& is);
+#endif
+
+private:
+
+    enum Reg {
+        DLY_SEL,
+        WLEVEL_EN,
+        CDLY_RST,
+        CDLY_INC,
+        RDLY_DQ_RST,
+        RDLY_DQ_INC,
+        RDLY_DQ_BITSLIP_RST,
+        RDLY_DQ_BITSLIP,
+        WDLY_DQ_RST,
+        WDLY_DQ_INC,
+        WDLY_DQS_RST,
+        WDLY_DQS_INC,
+        WDLY_DQ_BITSLIP_RST,
+        WDLY_DQ_BITSLIP,
+    };
+
+    // Applies op to the counters of all selected modules
+    template <typename Op>
+    void selected (Op op);
+
+    std::unordered_map<uint32_t, Reg> m_regs;
+
+    uint32_t m_dlySel;
+    bool     m_wlevelEn;
+    int      m_cdly;
+    int      m_rdly[MAX_MODULES];
+    int      m_wdly[MAX_MODULES];
+    int      m_wdlyDqs[MAX_MODULES];
+    int      m_rdlyBitslip[MAX_MODULES];
+    int      m_wdlyBitslip[MAX_MODULES];
+
+    uint64_t m_writes;
+};
+
+// PHY shadow fed by sim_top.sv
+PhyCsr& phy_csr ();
+
+#endif // SIM_PHY_CSR_H
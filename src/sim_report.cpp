@@ -0,0 +1,148 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_report.h"
+
+#include <sys/resource.h>
+
+namespace {
+
+std::string json_string (const std::string& str) {
+    std::string out = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+double rate (double count, double wall) {
+    return wall > 0.0 ? count / wall : 0.0;
+}
+
+} // namespace
+
+void SimReport::start (uint64_t cycle) {
+    m_wallStart  = Clock::now();
+    m_cycleStart = cycle;
+}
+
+void SimReport::mark (uint32_t id, const std::string& name, uint64_t cycle) {
+    Clock::time_point now = Clock::now();
+    endPhase(cycle, now);
+
+    if (id == 0)
+        return;
+
+    Phase phase = {};
+    phase.id    = id;
+    phase.name  = name.empty() ? "phase " + std::to_string(id) : name;
+    phase.start = cycle;
+    m_phases.push_back(phase);
+
+    m_phaseStart = now;
+    m_inPhase    = true;
+
+    fprintf(stderr, "[sim] Phase '%s' started at cycle %llu\n",
+            phase.name.c_str(), (unsigned long long)cycle);
+}
+
+void SimReport::endPhase (uint64_t cycle, Clock::time_point now) {
+    if (!m_inPhase)
+        return;
+
+    Phase& phase = m_phases.back();
+    phase.cycles = cycle - phase.start;
+    phase.wall   = std::chrono::duration<double>(now - m_phaseStart).count();
+    m_inPhase    = false;
+}
+
+void SimReport::stop (uint64_t cycle, double time, uint64_t evals,
+                      const std::string& status, int exit_code) {
+    Clock::time_point now = Clock::now();
+    endPhase(cycle, now);
+
+    m_wall     = std::chrono::duration<double>(now - m_wallStart).count();
+    m_time     = time;
+    m_cycles   = cycle - m_cycleStart;
+    m_evals    = evals;
+    m_status   = status;
+    m_exitCode = exit_code;
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        m_peakRss = usage.ru_maxrss;
+}
+
+void SimReport::metric (const std::string& name, double value) {
+    m_metrics.push_back({ name, value });
+}
+
+void SimReport::print (FILE* fp) const {
+    fprintf(fp, "[sim] %llu cycles in %.3f s, %.1f cycles/s\n",
+            (unsigned long long)m_cycles, m_wall, rate(m_cycles, m_wall));
+    fprintf(fp, "[sim] Simulated time: %.3f us, %llu evals (%.1f evals/s)\n",
+            m_time * 1e-3, (unsigned long long)m_evals, rate(m_evals, m_wall));
+    fprintf(fp, "[sim] Peak RSS: %.1f MiB, %s (exit code %d)\n",
+            m_peakRss / 1024.0, m_status.c_str(), m_exitCode);
+
+    if (m_phases.empty())
+        return;
+
+    fprintf(fp, "[sim] %-24s %12s %12s %10s %14s\n",
+            "Phase", "Start", "Cycles", "Wall [s]", "Cycles/s");
+    for (const Phase& phase : m_phases)
+        fprintf(fp, "[sim] %-24s %12llu %12llu %10.3f %14.1f\n",
+                phase.name.c_str(),
+                (unsigned long long)phase.start,
+                (unsigned long long)phase.cycles,
+                phase.wall, rate(phase.cycles, phase.wall));
+}
+
+bool SimReport::writeJson (const std::string& path) const {
+    FILE* fp = fopen(path.c_str(), "w");
+    if (fp == NULL)
+        return false;
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"wall_s\": %.6f,\n", m_wall);
+    fprintf(fp, "  \"sim_time_ns\": %.3f,\n", m_time);
+    fprintf(fp, "  \"cycles\": %llu,\n", (unsigned long long)m_cycles);
+    fprintf(fp, "  \"evals\": %llu,\n", (unsigned long long)m_evals);
+    fprintf(fp, "  \"cycles_per_s\": %.1f,\n", rate(m_cycles, m_wall));
+    fprintf(fp, "  \"peak_rss_kib\": %ld,\n", m_peakRss);
+    fprintf(fp, "  \"status\": %s,\n", json_string(m_status).c_str());
+    fprintf(fp, "  \"exit_code\": %d,\n", m_exitCode);
+    fprintf(fp, "  \"phases\": [");
+
+    for (size_t i = 0; i < m_phases.size(); ++i) {
+        const Phase& phase = m_phases[i];
+        fprintf(fp, "%s\n    {\"id\": %u, \"name\": %s, \"start\": %llu, "
+                "\"cycles\": %llu, \"wall_s\": %.6f}",
+                i ? "," : "", phase.id, json_string(phase.name).c_str(),
+                (unsigned long long)phase.start,
+                (unsigned long long)phase.cycles, phase.wall);
+    }
+
+    fprintf(fp, "%s],\n", m_phases.empty() ? "" : "\n  ");
+    fprintf(fp, "  \"metrics\": {");
+
+    // Cycle counts in the metrics go beyond what %g keeps, %.17g writes
+    // them as integers and every double exactly
+    for (size_t i = 0; i < m_metrics.size(); ++i)
+        fprintf(fp, "%s\n    %s: %.17g", i ? "," : "",
+                json_string(m_metrics[i].first).c_str(), m_metrics[i].second);
+
+    fprintf(fp, "%s}\n}\n", m_metrics.empty() ? "" : "\n  ");
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,70 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_REPORT_H
+#define SIM_REPORT_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Performance report of a simulation run: simulator throughput and
+// per-phase cycle counts and wall time of firmware declared phases.
+class SimReport {
+public:
+
+    struct Phase {
+        uint32_t    id;
+        std::string name;
+        uint64_t    start;      // Sys clock cycle
+        uint64_t    cycles;
+        double      wall;       // Seconds
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Starts measuring at the given cycle
+    void start (uint64_t cycle);
+
+    // Ends the current phase and starts a new one unless id is 0
+    void mark (uint32_t id, const std::string& name, uint64_t cycle);
+
+    // Stops measuring. time is the simulated time in ns, status says how
+    // the simulation ended.
+    void stop (uint64_t cycle, double time, uint64_t evals,
+               const std::string& status, int exit_code);
+
+    // Adds a named value, e.g. a training result, to the report
+    void metric (const std::string& name, double value);
+
+    const std::vector<Phase>& phases () const { return m_phases; }
+
+    void print (FILE* fp) const;
+    bool writeJson (const std::string& path) const;
+
+private:
+
+    void endPhase (uint64_t cycle, Clock::time_point now);
+
+    Clock::time_point  m_wallStart;
+    Clock::time_point  m_phaseStart;
+    uint64_t           m_cycleStart = 0;
+    bool               m_inPhase    = false;
+    std::vector<Phase> m_phases;
+
+    std::vector<std::pair<std::string, double>> m_metrics;
+
+    double             m_wall     = 0.0;
+    double             m_time     = 0.0;
+    uint64_t           m_cycles   = 0;
+    uint64_t           m_evals    = 0;
+    long               m_peakRss  = 0;    // KiB
+    std::string        m_status;
+    int                m_exitCode = 0;
+};
+
+#endif // SIM_REPORT_H
@@ -0,0 +1,374 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_serdes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "sim_lpddr4.h"
+#include "Vsim_top__Dpi.h"
+#ifdef SIM_SAVABLE
+#include "sim_snapshot.h"
+#endif
+
+namespace {
+
+// Bits per CLKDIV period
+const int BITS = 8;
+
+// Read data output delay of the device after the CK edge (tDQSCK)
+const double T_DQSCK_PS = 1500.0;
+
+int64_t floor_div (int64_t a, int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Pad index of a map pad name, -1 if unknown
+int pad_index (const std::string& name, int cke, int odt, int reset_n) {
+    static const struct {
+        const char* name;
+        int         first;
+        int         count;
+    } groups[] = {
+        { "dqs", Channel::DQS, Channel::LANES   },
+        { "dmi", Channel::DMI, Channel::LANES   },
+        { "dq",  Channel::DQ,  Channel::DQ_BITS },
+        { "ca",  Channel::CA,  Channel::CA_BITS },
+    };
+
+    if (name == "ck")      return Channel::CK;
+    if (name == "cs")      return Channel::CS;
+    if (name == "cke")     return cke;
+    if (name == "odt")     return odt;
+    if (name == "reset_n") return reset_n;
+
+    for (const auto& group : groups) {
+        size_t len = strlen(group.name);
+        if (name.compare(0, len, group.name) != 0 || name.size() == len)
+            continue;
+        char* end;
+        long index = strtol(name.c_str() + len, &end, 10);
+        if (*end != '\0' || index < 0 || index >= group.count)
+            return -1;
+        return group.first + index;
+    }
+    return -1;
+}
+
+} // namespace
+
+SerdesBus::SerdesBus () :
+    m_channel (NULL),
+    m_period  (0.0),
+    m_step    (0),
+    m_words   (0),
+    m_edges   (0),
+    m_warned  (false)
+{
+    memset(m_pads, 0, sizeof(m_pads));
+    for (Pad& pad : m_pads)
+        for (uint64_t& count : pad.count)
+            count = UINT64_MAX;
+
+    m_drive.push_back({ -1e300, 0, 0, 0, 0, 0 });
+}
+
+bool SerdesBus::load (const std::string& path) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open serdes map '%s'\n", path.c_str());
+        return false;
+    }
+
+    static const char* const KINDS[] = { "iserdes", "oserdes", "idelay", "odelay" };
+
+    char line[256];
+    int  lineno = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+
+        char name[128], kind[16], pad[16], clock[64] = "";
+        int  fields = sscanf(line, "%127s %15s %15s %63s", name, kind, pad, clock);
+        if (fields <= 0)
+            continue;
+
+        Entry entry;
+        entry.kind = -1;
+        for (int i = 0; i < 4; ++i)
+            if (fields >= 2 && strcmp(kind, KINDS[i]) == 0)
+                entry.kind = i;
+        entry.pad = fields >= 3 ? pad_index(pad, CKE, ODT, RESET_N) : -1;
+
+        if (entry.kind < 0 || entry.pad < 0) {
+            fprintf(stderr, "%s:%d: expected '<instance> <kind> <pad> [<clock>]'\n",
+                    path.c_str(), lineno);
+            fclose(fp);
+            return false;
+        }
+
+        // Serializers on the 90 degrees shifted sys8x clock launch a
+        // quarter of its period, half a bit, later
+        entry.phase = strstr(clock, "90") ? 0.5 : 0.0;
+        m_map[name] = entry;
+    }
+    fclose(fp);
+    return true;
+}
+
+int SerdesBus::attach (int kind, const char* path) {
+    // Instances are looked up by the last component of their path
+    const char* name = strrchr(path, '.');
+    name = name ? name + 1 : path;
+
+    auto it = m_map.find(name);
+    if (it == m_map.end() || it->second.kind != kind) {
+        if (!m_warned && !m_map.empty())
+            fprintf(stderr, "[sim] Serdes: %s not in the map, left idle\n", path);
+        m_warned = true;
+        return -1;
+    }
+
+    if (kind == OSERDES)
+        m_pads[it->second.pad].phase = it->second.phase;
+
+    m_instances.push_back({ kind, it->second.pad });
+    return (int)m_instances.size() - 1;
+}
+
+void SerdesBus::output (int id, uint64_t count, uint8_t data, uint8_t oe) {
+    // Handles of a restored model may be unknown, the bus is not saved
+    if ((size_t)id >= m_instances.size())
+        return;
+
+    Pad& pad = m_pads[m_instances[id].pad];
+    int  slot = count % RING;
+
+    pad.count[slot] = count;
+    pad.data[slot]  = data;
+    pad.oe[slot]    = oe;
+    m_words++;
+}
+
+uint8_t SerdesBus::input (int id, uint64_t count) {
+    if ((size_t)id >= m_instances.size())
+        return 0;
+    advance(count);
+    m_words++;
+
+    // Bits of the period that ended at this edge, sampled on the sys8x
+    // edges the period starts with
+    int     pad  = m_instances[id].pad;
+    double  t0   = (count - 1) * m_period;
+    double  ui   = m_period / BITS;
+    uint8_t word = 0;
+
+    for (int k = 0; k < BITS; ++k) {
+        double t = t0 + k * ui - m_pads[pad].idelay * m_channel->tap() -
+                   m_channel->signal(pad).delay - jitter(pad);
+        word |= drive(pad, t) << k;
+    }
+    return word;
+}
+
+void SerdesBus::delay (int id, int taps) {
+    if ((size_t)id >= m_instances.size())
+        return;
+
+    Instance& inst = m_instances[id];
+    if (inst.kind == IDELAY)
+        m_pads[inst.pad].idelay = taps;
+    else
+        m_pads[inst.pad].odelay = taps;
+}
+
+void SerdesBus::advance (uint64_t count) {
+    if (m_channel == NULL) {
+        // The device sees the channel through the pad timing only
+        Lpddr4& device = lpddr4_model();
+        m_channel = device.channel() ? device.channel() : &m_ideal;
+        m_period  = BITS * m_channel->ui();
+        device.setChannel(NULL);
+    }
+
+    while (m_step < count)
+        step(++m_step);
+}
+
+void SerdesBus::step (uint64_t count) {
+    Lpddr4& device = lpddr4_model();
+
+    double t0 = (count - 1) * m_period;
+    double t1 = count * m_period;
+
+    m_edgeBuf.clear();
+    edgesOf(Channel::CK, -1, t0, t1, m_edgeBuf);
+    for (int lane = 0; lane < Channel::LANES; ++lane)
+        edgesOf(Channel::DQS + lane, lane, t0, t1, m_edgeBuf);
+
+    std::sort(m_edgeBuf.begin(), m_edgeBuf.end(),
+              [](const Edge& a, const Edge& b) { return a.time < b.time; });
+
+    for (const Edge& edge : m_edgeBuf) {
+        double t = edge.time;
+
+        if (edge.lane < 0) {
+            uint8_t ca = 0;
+            for (int i = 0; i < Channel::CA_BITS; ++i)
+                ca |= level(Channel::CA + i, t) << i;
+            device.clock(edge.rise, level(Channel::CS, t), ca,
+                         level(CKE, t), level(RESET_N, t));
+        } else {
+            uint8_t dq = 0;
+            for (int i = 0; i < 8; ++i)
+                dq |= level(Channel::DQ + 8 * edge.lane + i, t) << i;
+            device.strobe(edge.lane, edge.rise, dq, level(Channel::DMI + edge.lane, t));
+        }
+        record(t + T_DQSCK_PS);
+    }
+    m_edges += m_edgeBuf.size();
+
+    // Keep the drive history the delay lines can reach back to
+    while (m_drive.size() > 2 && m_drive[1].time < t0 - 2 * m_period)
+        m_drive.pop_front();
+}
+
+void SerdesBus::edgesOf (int pad, int lane, double t0, double t1, std::vector<Edge>& edges) {
+    double  ui  = m_period / BITS;
+    double  off = offset(pad);
+    int64_t g   = (int64_t)std::ceil((t0 - off) / ui);
+
+    for (; off + g * ui < t1; ++g) {
+        bool value = bit(pad, g);
+        if (value == bit(pad, g - 1))
+            continue;
+        // DQS edges only while driven by the controller
+        if (lane >= 0 && !(bit(pad, g, true) && bit(pad, g - 1, true)))
+            continue;
+        edges.push_back({ off + g * ui + jitter(pad), lane, value });
+    }
+}
+
+bool SerdesBus::bit (int pad, int64_t g, bool oe) const {
+    int64_t count = floor_div(g, BITS);
+    if (count < 0)
+        return false;
+
+    const Pad& p = m_pads[pad];
+    int slot = count % RING;
+    if (p.count[slot] != (uint64_t)count)
+        return false;
+    return ((oe ? p.oe[slot] : p.data[slot]) >> (g - count * BITS)) & 1;
+}
+
+double SerdesBus::offset (int pad) const {
+    double ui  = m_period / BITS;
+    double off = m_period + m_pads[pad].phase * ui + m_pads[pad].odelay * m_channel->tap();
+    if (pad < Channel::SIGNALS)
+        off += m_channel->signal(pad).delay;
+    return off;
+}
+
+double SerdesBus::jitter (int pad) {
+    return pad < Channel::SIGNALS ? m_channel->jitter(pad) : 0.0;
+}
+
+double SerdesBus::eye (int pad) const {
+    return pad < Channel::SIGNALS ? m_channel->signal(pad).eye : m_period / BITS;
+}
+
+bool SerdesBus::level (int pad, double t) {
+    double  ui = m_period / BITS;
+    double  x  = (t - offset(pad) - jitter(pad)) / ui;
+    int64_t g  = (int64_t)std::floor(x);
+    double  at = (x - g) * ui;
+    bool    value  = bit(pad, g);
+    double  margin = (ui - eye(pad)) / 2;
+
+    // Sampled too close to a transition
+    if ((at < margin && bit(pad, g - 1) != value) ||
+        (at > ui - margin && bit(pad, g + 1) != value))
+        return m_channel->random();
+    return value;
+}
+
+bool SerdesBus::drive (int pad, double t) {
+    auto value = [pad](const Drive& d) -> bool {
+        if (pad >= Channel::DMI)
+            return (d.dqOe >> (pad - Channel::DMI)) & (d.dmi >> (pad - Channel::DMI)) & 1;
+        if (pad >= Channel::DQS)
+            return (d.dqsOe >> (pad - Channel::DQS)) & (d.dqs >> (pad - Channel::DQS)) & 1;
+        return (d.dqOe >> (pad / 8)) & (d.dq >> pad) & 1;
+    };
+
+    auto it = std::upper_bound(m_drive.begin(), m_drive.end(), t,
+                               [](double t, const Drive& d) { return t < d.time; });
+    size_t i = it - m_drive.begin() - 1;
+    bool   v = value(m_drive[i]);
+
+    double margin = (m_period / BITS - eye(pad)) / 2;
+    if ((i > 0 && t - m_drive[i].time < margin && value(m_drive[i - 1]) != v) ||
+        (i + 1 < m_drive.size() && m_drive[i + 1].time - t < margin && value(m_drive[i + 1]) != v))
+        return m_channel->random();
+    return v;
+}
+
+void SerdesBus::record (double t) {
+    const Lpddr4& device = lpddr4_model();
+    Drive& last = m_drive.back();
+
+    if (device.dq() == last.dq && device.dqOe() == last.dqOe && device.dmi() == last.dmi &&
+        device.dqs() == last.dqs && device.dqsOe() == last.dqsOe)
+        return;
+    m_drive.push_back({ std::max(t, last.time), device.dq(), device.dqOe(), device.dmi(),
+                        device.dqs(), device.dqsOe() });
+}
+
+#ifdef SIM_SAVABLE
+void SerdesBus::save (VerilatedSerialize& os) const {
+    snapshot_put_all(os, m_instances);
+    snapshot_put(os, m_pads);
+    snapshot_put_all(os, m_drive);
+    m_ideal.save(os);
+    snapshot_put(os, m_step);
+    snapshot_put(os, m_words);
+    snapshot_put(os, m_edges);
+    snapshot_put(os, m_warned);
+}
+
+void SerdesBus::restore (VerilatedDeserialize& is) {
+    snapshot_get_all(is, m_instances);
+    snapshot_get(is, m_pads);
+    snapshot_get_all(is, m_drive);
+    m_ideal.restore(is);
+    snapshot_get(is, m_step);
+    snapshot_get(is, m_words);
+    snapshot_get(is, m_edges);
+    snapshot_get(is, m_warned);
+}
+#endif
+
+SerdesBus& serdes_bus () {
+    static SerdesBus bus;
+    return bus;
+}
+
+int sim_serdes_attach (int kind, const char* path) {
+    return serdes_bus().attach(kind, path);
+}
+
+void sim_oserdes_word (int id, long long count, char data, char oe) {
+    serdes_bus().output(id, count, (uint8_t)data, (uint8_t)oe);
+}
+
+char sim_iserdes_word (int id, long long count) {
+    return (char)serdes_bus().input(id, count);
+}
+
+void sim_delay_taps (int id, int taps) {
+    serdes_bus().delay(id, taps);
+}
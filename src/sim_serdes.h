@@ -0,0 +1,161 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_SERDES_H
+#define SIM_SERDES_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sim_channel.h"
+
+// Word level link between the serdes models of rtl/sim/sim_serdes.sv and
+// the LPDDR4 device. OSERDESE2 instances post the 8 bits they serialize in
+// one CLKDIV (sys2x) period, ISERDESE2 instances fetch the 8 bits they
+// deserialize and IDELAYE2/ODELAYE2 report their tap counts. The bus keeps
+// the pad timing itself: once a CLKDIV period is over it replays the CK
+// and DQS edges of that period in time order into the device (Lpddr4),
+// sampling CA, CS and write data at the edge times, and records when the
+// device changes its DQ, DMI or DQS drive for the ISERDES instances. Pad
+// timing combines the delay taps, the delays, jitter and eyes of the
+// channel and the clock of the serializer.
+//
+// Instances are matched with pads by name, using the map generated from
+// the PHY netlist by src/serdes_map.py. Times are in ps, counts are CLKDIV
+// edges since the start of the simulation.
+class SerdesBus {
+public:
+
+    // Instance kinds, as passed by sim_serdes.sv
+    enum Kind {
+        ISERDES,
+        OSERDES,
+        IDELAY,
+        ODELAY,
+    };
+
+    SerdesBus ();
+
+    // Reads the instance map. Returns false and prints the reason on
+    // failure.
+    bool load (const std::string& path);
+
+    // Registers an instance by its hierarchical name. Returns its handle or
+    // -1 if it does not serve a DRAM pad.
+    int attach (int kind, const char* path);
+
+    // Serdes words, bit k is the k-th bit in time
+    void    output (int id, uint64_t count, uint8_t data, uint8_t oe);
+    uint8_t input  (int id, uint64_t count);
+
+    // Delay line taps
+    void delay (int id, int taps);
+
+    bool     active    () const { return !m_instances.empty(); }
+    size_t   instances () const { return m_instances.size(); }
+    uint64_t words     () const { return m_words; }
+    uint64_t edges     () const { return m_edges; }
+
+#ifdef SIM_SAVABLE
+    // Instances, pad words and device drive for snapshots. The instances
+    // attach once at elaboration, which a restored model does not repeat.
+    void save    (VerilatedSerialize& os) const;
+    void restore (VerilatedDeserialize& is);
+#endif
+
+private:
+
+    // Pads, the channel signal indices followed by the ones the channel
+    // does not model
+    enum {
+        CKE     = Channel::SIGNALS,
+        ODT,
+        RESET_N,
+        PADS,
+    };
+
+    // Words kept per pad, enough for the longest pad delay
+    static const int RING = 4;
+
+    struct Pad {
+        uint64_t count[RING];
+        uint8_t  data[RING];
+        uint8_t  oe[RING];
+        int      odelay;        // Taps
+        int      idelay;
+        double   phase;         // Clock phase of the serializer
+    };
+
+    struct Instance {
+        int kind;
+        int pad;
+    };
+
+    struct Entry {
+        int    kind;
+        int    pad;
+        double phase;
+    };
+
+    // Device drive from a given time on
+    struct Drive {
+        double   time;
+        uint16_t dq;
+        uint8_t  dqOe;
+        uint8_t  dmi;
+        uint8_t  dqs;
+        uint8_t  dqsOe;
+    };
+
+    // CK or DQS edge
+    struct Edge {
+        double time;
+        int    lane;            // -1 for CK
+        bool   rise;
+    };
+
+    // Replays all CLKDIV periods up to count
+    void advance (uint64_t count);
+    void step (uint64_t count);
+
+    // Nominal bit g of a pad, bit 0 launched one CLKDIV period after
+    // the first edge
+    bool   bit (int pad, int64_t g, bool oe = false) const;
+    double offset (int pad) const;
+    double jitter (int pad);
+    double eye (int pad) const;
+
+    // Pad level seen by the device at time t
+    bool level (int pad, double t);
+
+    // Device drive seen by an ISERDES at time t
+    bool drive (int pad, double t);
+    void record (double t);
+
+    void edgesOf (int pad, int lane, double t0, double t1, std::vector<Edge>& edges);
+
+    std::unordered_map<std::string, Entry> m_map;
+    std::vector<Instance>                  m_instances;
+
+    Pad                m_pads[PADS];
+    std::deque<Drive>  m_drive;
+    std::vector<Edge>  m_edgeBuf;
+
+    Channel            m_ideal;
+    Channel*           m_channel;
+    double             m_period;        // CLKDIV
+    uint64_t           m_step;
+
+    uint64_t           m_words;
+    uint64_t           m_edges;
+    bool               m_warned;
+};
+
+// Bus instance driven by sim_serdes.sv
+SerdesBus& serdes_bus ();
+
+#endif // SIM_SERDES_H
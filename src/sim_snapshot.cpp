@@ -0,0 +1,115 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_snapshot.h"
+
+#include <cstdio>
+
+#include "verilated.h"
+
+uint64_t firmware_hash (const std::string& path) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == NULL)
+        return 0;
+
+    // 64-bit FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint8_t  buf[4096];
+    size_t   len;
+
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= buf[i];
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    fclose(fp);
+    return hash;
+}
+
+bool SnapshotSave::open (const std::string& path) {
+    m_file = gzopen(path.c_str(), "wb1");
+    if (m_file == NULL)
+        return false;
+
+    m_isOpen   = true;
+    m_filename = path;
+    m_cp       = m_bufp;
+    header();
+    return true;
+}
+
+void SnapshotSave::close () {
+    if (!m_isOpen)
+        return;
+
+    trailer();
+    flush();
+    m_isOpen = false;
+
+    gzclose(m_file);
+    m_file = NULL;
+}
+
+void SnapshotSave::flush () {
+    if (!m_isOpen)
+        return;
+
+    size_t len = m_cp - m_bufp;
+    if (len && gzwrite(m_file, m_bufp, len) != (int)len) {
+        VL_FATAL_MT(m_filename.c_str(), 0, "", "Snapshot write failed");
+        m_isOpen = false;
+    }
+
+    m_cp = m_bufp;
+}
+
+bool SnapshotRestore::open (const std::string& path) {
+    m_file = gzopen(path.c_str(), "rb");
+    if (m_file == NULL)
+        return false;
+
+    m_isOpen   = true;
+    m_filename = path;
+    m_cp       = m_bufp;
+    m_endp     = m_bufp;
+    header();
+    return true;
+}
+
+void SnapshotRestore::close () {
+    if (!m_isOpen)
+        return;
+
+    trailer();
+    m_isOpen = false;
+
+    gzclose(m_file);
+    m_file = NULL;
+}
+
+void SnapshotRestore::fill () {
+    if (!m_isOpen)
+        return;
+
+    // Move the unread data to the start of the buffer
+    uint8_t* rp = m_bufp;
+    for (uint8_t* sp = m_cp; sp < m_endp; *rp++ = *sp++) {}
+    m_endp = m_bufp + (m_endp - m_cp);
+    m_cp   = m_bufp;
+
+    // Refill. Past the end of file pad with zeros like VerilatedRestore.
+    int remaining = (int)(m_bufp + bufferSize() - m_endp);
+    int got = gzread(m_file, m_endp, remaining);
+    if (got < 0) {
+        VL_FATAL_MT(m_filename.c_str(), 0, "", "Snapshot read failed");
+        m_isOpen = false;
+        return;
+    }
+
+    m_endp += got;
+    while (m_endp < m_bufp + bufferSize())
+        *m_endp++ = 0;
+}
@@ -0,0 +1,84 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_SNAPSHOT_H
+#define SIM_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+
+#include <zlib.h>
+
+#include "verilated_save.h"
+
+// Hash of a firmware image file, recorded in snapshots so that a snapshot
+// taken with a different firmware is rejected on restore. Returns 0 if the
+// file cannot be read.
+uint64_t firmware_hash (const std::string& path);
+
+// gzip compressed counterparts of VerilatedSave and VerilatedRestore
+class SnapshotSave : public VerilatedSerialize {
+public:
+    ~SnapshotSave () override { close(); }
+
+    bool open (const std::string& path);
+    void close () override;
+    void flush () override;
+
+private:
+    gzFile m_file = NULL;
+};
+
+class SnapshotRestore : public VerilatedDeserialize {
+public:
+    ~SnapshotRestore () override { close(); }
+
+    bool open (const std::string& path);
+    void close () override;
+    void flush () override {}
+    void fill () override;
+
+private:
+    gzFile m_file = NULL;
+};
+
+// Plain values and sequences of plain values, for the save() and restore()
+// methods of the C++ models
+template <typename T>
+void snapshot_put (VerilatedSerialize& os, const T& value) {
+    os.write(&value, sizeof(value));
+}
+
+template <typename T>
+void snapshot_get (VerilatedDeserialize& is, T& value) {
+    is.read(&value, sizeof(value));
+}
+
+template <typename C>
+void snapshot_put_all (VerilatedSerialize& os, const C& items) {
+    snapshot_put(os, (uint64_t)items.size());
+    for (const auto& item : items)
+        snapshot_put(os, item);
+}
+
+template <typename C>
+void snapshot_get_all (VerilatedDeserialize& is, C& items) {
+    uint64_t size;
+    snapshot_get(is, size);
+    items.resize(size);
+    for (auto& item : items)
+        snapshot_get(is, item);
+}
+
+// Snapshot file header
+struct SnapshotHeader {
+    char     magic[8];
+    uint32_t version;
+    uint64_t firmware;
+};
+
+#define SNAPSHOT_MAGIC   "VSIMSNAP"
+#define SNAPSHOT_VERSION 3
+
+#endif // SIM_SNAPSHOT_H
@@ -0,0 +1,88 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_uart.h"
+
+namespace {
+
+// NCO increments per bit: 16 overflows of a 16-bit accumulator
+const uint64_t BIT_PHASE = 16ULL << 16;
+
+// Start bit, 8 data bits, stop bit
+const int FRAME_BITS = 10;
+
+} // namespace
+
+UartRx::UartRx () :
+    m_fp          (NULL),
+    m_state       (IDLE),
+    m_phase       (0),
+    m_bit         (0),
+    m_shift       (0),
+    m_txPrev      (1),
+    m_frameErrors (0)
+{
+}
+
+UartRx::~UartRx () {
+    close();
+}
+
+bool UartRx::open (const char* path) {
+    close();
+    m_fp = fopen(path, "wb");
+    return m_fp != NULL;
+}
+
+void UartRx::close () {
+    if (m_fp != NULL) {
+        fclose(m_fp);
+        m_fp = NULL;
+    }
+}
+
+void UartRx::tick (uint8_t tx, uint16_t nco) {
+    uint8_t txPrev = m_txPrev;
+    m_txPrev = tx;
+
+    if (m_state == IDLE) {
+        // Falling edge marks the start bit
+        if (txPrev && !tx && nco != 0) {
+            m_state = RECEIVE;
+            m_phase = 0;
+            m_bit   = 0;
+            m_shift = 0;
+        }
+        return;
+    }
+
+    // Sample each bit in its middle
+    m_phase += nco;
+    if (m_phase < BIT_PHASE * m_bit + BIT_PHASE / 2)
+        return;
+
+    if (m_bit == 0 && tx) {
+        // Glitch, not a start bit
+        m_state = IDLE;
+        return;
+    }
+
+    m_shift |= (uint16_t)(tx & 1) << m_bit;
+    if (++m_bit < FRAME_BITS)
+        return;
+
+    m_state = IDLE;
+    if (m_shift & (1 << (FRAME_BITS - 1)))
+        receive((m_shift >> 1) & 0xFF);
+    else
+        m_frameErrors++;
+}
+
+void UartRx::receive (uint8_t data) {
+    fputc(data, stdout);
+    fflush(stdout);
+
+    if (m_fp != NULL)
+        fputc(data, m_fp);
+}
@@ -0,0 +1,51 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_UART_H
+#define SIM_UART_H
+
+#include <cstdint>
+#include <cstdio>
+
+// UART receiver decoding the TX line of the OpenTitan UART. It is clocked
+// once per sys clock cycle. The bit period follows the NCO setting of the
+// transmitter: the NCO advances by its value every cycle and one bit lasts
+// 16 overflows of its 16-bit accumulator. Frames are 8N1 (parity is not
+// used by the firmware).
+class UartRx {
+public:
+
+    UartRx  ();
+    ~UartRx ();
+
+    // Opens the file decoded characters are written to. Characters are
+    // always echoed to stdout.
+    bool open (const char* path);
+    void close ();
+
+    // Samples the TX line. Called once per sys clock cycle.
+    void tick (uint8_t tx, uint16_t nco);
+
+    // Number of frames with an invalid stop bit
+    uint64_t frameErrors () const { return m_frameErrors; }
+
+private:
+
+    enum State {
+        IDLE,
+        RECEIVE,
+    };
+
+    void receive (uint8_t data);
+
+    FILE*    m_fp;
+    State    m_state;
+    uint64_t m_phase;       // NCO increments accumulated since start bit
+    int      m_bit;         // Index of the next bit to sample
+    uint16_t m_shift;
+    uint8_t  m_txPrev;
+    uint64_t m_frameErrors;
+};
+
+#endif // SIM_UART_H
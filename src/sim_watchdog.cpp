@@ -0,0 +1,80 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sim_watchdog.h"
+
+Watchdog::Watchdog (uint64_t limit, uint64_t cycle) :
+    m_limit        (limit),
+    m_lastProgress (cycle),
+    m_loopLo       (UINT32_MAX),
+    m_loopHi       (0),
+    m_fired        (false),
+    m_fetchHead    (0),
+    m_lastFetch    (UINT32_MAX),
+    m_accessHead   (0)
+{
+}
+
+template <typename T>
+void Watchdog::push (std::vector<T>& ring, size_t& head, const T& item) {
+    if (ring.size() < HISTORY) {
+        ring.push_back(item);
+    } else {
+        ring[head] = item;
+        head = (head + 1) % HISTORY;
+    }
+}
+
+void Watchdog::tick (uint64_t cycle,
+                     bool rom_req, uint32_t rom_addr,
+                     bool ram_req, bool ram_we, uint32_t ram_addr, uint32_t ram_data) {
+
+    if (rom_req) {
+        if (rom_addr != m_lastFetch)
+            push(m_fetches, m_fetchHead, rom_addr);
+        m_lastFetch = rom_addr;
+
+        // Leaving the loop window is progress
+        uint32_t lo = rom_addr < m_loopLo ? rom_addr : m_loopLo;
+        uint32_t hi = rom_addr > m_loopHi ? rom_addr : m_loopHi;
+        if (hi - lo >= LOOP_SPAN)
+            progress(cycle, rom_addr);
+        else {
+            m_loopLo = lo;
+            m_loopHi = hi;
+        }
+    }
+
+    if (ram_req) {
+        push(m_accesses, m_accessHead, Access{cycle, ram_addr, ram_data, ram_we});
+        if (ram_we)
+            progress(cycle, m_lastFetch);
+    }
+
+    if (m_limit != 0 && cycle - m_lastProgress >= m_limit)
+        m_fired = true;
+}
+
+void Watchdog::progress (uint64_t cycle, uint32_t addr) {
+    m_lastProgress = cycle;
+    m_loopLo = addr;
+    m_loopHi = addr;
+}
+
+void Watchdog::dump (FILE* fp) const {
+    fprintf(fp, "[sim] Last ROM read addresses:\n");
+    for (size_t i = 0; i < m_fetches.size(); ++i)
+        fprintf(fp, "[sim]   0x%08X\n", m_fetches[(m_fetchHead + i) % m_fetches.size()]);
+
+    fprintf(fp, "[sim] Last RAM transactions:\n");
+    for (size_t i = 0; i < m_accesses.size(); ++i) {
+        const Access& acc = m_accesses[(m_accessHead + i) % m_accesses.size()];
+        if (acc.we)
+            fprintf(fp, "[sim]   %12llu  W 0x%08X <= 0x%08X\n",
+                    (unsigned long long)acc.cycle, acc.addr, acc.data);
+        else
+            fprintf(fp, "[sim]   %12llu  R 0x%08X\n",
+                    (unsigned long long)acc.cycle, acc.addr);
+    }
+}
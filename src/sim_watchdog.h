@@ -0,0 +1,68 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_WATCHDOG_H
+#define SIM_WATCHDOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// No-progress watchdog. Watches the memory buses once per sys clock cycle
+// and fires when for a number of cycles the CPU neither wrote to RAM nor
+// fetched from outside of a small address window, i.e. it is spinning in
+// a tight loop. Keeps a history of recent fetch addresses and bus
+// transactions for post-mortem dumps.
+class Watchdog {
+public:
+
+    // Fetches within this many bytes count as the same loop
+    static const uint32_t LOOP_SPAN = 64;
+
+    // History depth
+    static const size_t HISTORY = 32;
+
+    struct Access {
+        uint64_t cycle;
+        uint32_t addr;
+        uint32_t data;
+        bool     we;
+    };
+
+    // Limit of cycles without progress, 0 disables the watchdog. Starts
+    // counting at the given cycle.
+    Watchdog (uint64_t limit, uint64_t cycle);
+
+    // Samples the buses. Addresses are CPU byte addresses.
+    void tick (uint64_t cycle,
+               bool rom_req, uint32_t rom_addr,
+               bool ram_req, bool ram_we, uint32_t ram_addr, uint32_t ram_data);
+
+    // True once no progress was seen for the limit of cycles
+    bool fired () const { return m_fired; }
+
+    // Prints the fetch and bus history, oldest first
+    void dump (FILE* fp) const;
+
+private:
+
+    void progress (uint64_t cycle, uint32_t addr);
+
+    template <typename T>
+    static void push (std::vector<T>& ring, size_t& head, const T& item);
+
+    uint64_t            m_limit;
+    uint64_t            m_lastProgress;
+    uint32_t            m_loopLo;
+    uint32_t            m_loopHi;
+    bool                m_fired;
+
+    std::vector<uint32_t> m_fetches;
+    size_t                m_fetchHead;
+    uint32_t              m_lastFetch;
+    std::vector<Access>   m_accesses;
+    size_t                m_accessHead;
+};
+
+#endif // SIM_WATCHDOG_H
@@ -2,46 +2,685 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <map>
+#include <string>
+
 #include "Vsim_top.h"
+#include "Vsim_top__Dpi.h"
 #include "verilated.h"
+
+#include "sim_elf.h"
+#include "sim_channel.h"
+#include "sim_dfi.h"
+#include "sim_host.h"
+#include "sim_init.h"
+#include "sim_lpddr4.h"
+#include "sim_phy_csr.h"
+#include "sim_serdes.h"
+#include "sim_report.h"
+#include "sim_uart.h"
+#include "sim_watchdog.h"
+
+#ifdef SIM_CPP_CLOCKS
+#include "sim_clocks.h"
+#endif
+
+#ifdef SIM_SAVABLE
+#include "sim_snapshot.h"
+#endif
+
+#if VM_TRACE_FST
+#include "verilated_fst_c.h"
+typedef VerilatedFstC TraceFile;
+#define TRACE_FILE_DEFAULT "dump.fst"
+#elif VM_TRACE
 #include "verilated_vcd_c.h"
+typedef VerilatedVcdC TraceFile;
+#define TRACE_FILE_DEFAULT "dump.vcd"
+#endif
+
+// Register map of the PHY, generated along with phy_core (see Makefile)
+#ifndef SIM_CSR_CSV
+#define SIM_CSR_CSV "csr.csv"
+#endif
+
+#ifndef SIM_SERDES_MAP
+#define SIM_SERDES_MAP "serdes_map.txt"
+#endif
 
 vluint64_t g_time = 0;
 
+#ifdef SIM_CPP_CLOCKS
+double sc_time_stamp () {
+    return (double)g_time;          // 1 tick equals 1/64 of sys clock period
+}
+
+// Simulated time in ns, the sys clock period is 1ns in both clocking modes
+static double sim_time_ns () {
+    return (double)g_time / ClockSchedule::TICKS_PER_SYS;
+}
+#else
 double sc_time_stamp () {
     return (double)g_time * 1e-2;   // 1 tick equals 0.01 time unit
 }
 
+static double sim_time_ns () {
+    return sc_time_stamp();         // 1 time unit equals 1ns
+}
+#endif
+
+// Runtime options given as "+name" or "+name=value"
+static std::map<std::string, std::string> g_plusargs;
+
+static void parse_plusargs (int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] != '+')
+            continue;
+
+        std::string arg(argv[i] + 1);
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos)
+            g_plusargs[arg] = "";
+        else
+            g_plusargs[arg.substr(0, eq)] = arg.substr(eq + 1);
+    }
+}
+
+static bool plusarg_has (const char* name) {
+    return g_plusargs.count(name) != 0;
+}
+
+static uint64_t plusarg_u64 (const char* name, uint64_t dflt) {
+    auto it = g_plusargs.find(name);
+    if (it == g_plusargs.end() || it->second.empty())
+        return dflt;
+    return strtoull(it->second.c_str(), NULL, 0);
+}
+
+static std::string plusarg_str (const char* name, const std::string& dflt) {
+    auto it = g_plusargs.find(name);
+    if (it == g_plusargs.end() || it->second.empty())
+        return dflt;
+    return it->second;
+}
+
+// Firmware byte address to the word address seen on the RAM bus of sim_top
+// (top_pkg::MEM_AW bits, addresses alias above that)
+static uint32_t mem_word (uint64_t addr) {
+    return (addr >> 2) & ((1u << 17) - 1);
+}
+
+// Waveform tracing window. Tracing is off unless requested with "+trace" or
+// any of the window options. Dumps happen only for sys clock cycles within
+// [start, end) and, if a trigger address is given, only while the last value
+// the firmware has written to it is non-zero.
+struct TraceWindow {
+    bool     enabled     = false;
+    bool     triggered   = true;
+    bool     has_trigger = false;
+    uint32_t trigger     = 0;
+    uint64_t start       = 0;
+    uint64_t end         = UINT64_MAX;
+    int      depth       = 24;
+
+    bool active (uint64_t cycle) const {
+        return enabled && triggered && cycle >= start && cycle < end;
+    }
+};
+
+static TraceWindow g_trace;
+
+static HostChannel g_host;
+
+#ifdef SIM_SAVABLE
+// Snapshot request. A snapshot is taken once, either at the given sys clock
+// cycle or after the firmware writes a non-zero value to the trigger address.
+struct SnapshotCtl {
+    uint64_t    cycle       = UINT64_MAX;
+    bool        has_trigger = false;
+    uint32_t    trigger     = 0;
+    bool        pending     = false;
+    std::string file;
+};
+
+static SnapshotCtl g_snapshot;
+#endif
+
+// Testbench state saved along with the model
+struct SimState {
+    uint64_t time;
+    uint64_t cycle;
+    uint64_t clock_pos;
+    uint8_t  clk_prev;
+    uint8_t  init_start;
+    InitTrigger::State init;
+};
+
+// Called from sim_top on every RAM write
+void sim_mem_write (int addr, int data, char mask) {
+    uint32_t word = (uint32_t)addr;
+
+    if (g_host.write(word, (uint32_t)data, (uint8_t)mask))
+        return;
+
+    if (g_trace.has_trigger && word == g_trace.trigger)
+        g_trace.triggered = (data != 0);
+
+#ifdef SIM_SAVABLE
+    if (g_snapshot.has_trigger && word == g_snapshot.trigger && data != 0) {
+        g_snapshot.has_trigger = false;
+        g_snapshot.pending = true;
+    }
+#endif
+}
+
+// Exit codes of Vsim_top
+enum SimExit {
+    EXIT_PASS      = 0,     // Firmware exited with 0
+    EXIT_FAIL      = 1,     // Firmware exited with a non-zero code
+    EXIT_TIMEOUT   = 2,     // +max_cycles reached
+    EXIT_HANG      = 3,     // No progress for +watchdog cycles
+    EXIT_EXCEPTION = 4,     // Unhandled exception in the firmware
+    EXIT_ERROR     = 5,     // Testbench setup error
+};
+
+// Reads an int array of the firmware by its symbol, missing elements are
+// set to -1
+static void read_symbol (const ElfImage& elf, const char* name, int* data, int count) {
+    auto it = elf.symbols.find(name);
+    svSetScope(svGetScopeFromName("TOP.sim_top"));
+    for (int i = 0; i < count; ++i) {
+        if (it == elf.symbols.end() || (uint32_t)(4 * i) >= it->second.size)
+            data[i] = -1;
+        else
+            data[i] = sim_ram_read(mem_word(it->second.addr + 4 * i));
+    }
+}
+
+// Default boot address, the one of ROM
+static const uint32_t BOOT_ADDR = 0x80000000;
+
+// Loads an ELF image straight into the ROM and RAM models and sets the
+// boot address from its entry point. Must be called before the first
+// evaluation.
+static bool load_elf (Vsim_top* top, const std::string& path, const ElfImage& elf) {
+    svSetScope(svGetScopeFromName("TOP.sim_top"));
+
+    for (const ElfImage::Segment& seg : elf.segments) {
+        for (size_t i = 0; i < seg.data.size(); ++i) {
+            uint32_t addr = seg.addr + i;
+
+            // Memory spans 0x80000000 - 0xBFFFFFFF, split into ROM and RAM
+            // at 128kB and aliased above
+            if ((addr >> 30) != 2) {
+                fprintf(stderr, "'%s': address 0x%08X is outside of the memory\n",
+                        path.c_str(), addr);
+                return false;
+            }
+
+            if (addr & (1u << 17)) {
+                uint32_t word  = mem_word(addr);
+                uint32_t shift = 8 * (addr & 3);
+                uint32_t data  = (uint32_t)sim_ram_read(word);
+                data = (data & ~(0xFFu << shift)) | ((uint32_t)seg.data[i] << shift);
+                sim_ram_load(word, data);
+            } else {
+                sim_rom_load(addr & ((1u << 17) - 1), seg.data[i]);
+            }
+        }
+    }
+
+    // Ibex starts at boot address + 0x80, the vector table must be 256B
+    // aligned
+    if ((elf.entry & 0xFF) == 0x80)
+        top->boot_addr_i = elf.entry - 0x80;
+    else
+        fprintf(stderr, "'%s': entry point 0x%08X is not at a vector table offset of 0x80, "
+                "booting from 0x%08X\n", path.c_str(), elf.entry, top->boot_addr_i);
+
+    return true;
+}
+
+#ifdef SIM_SAVABLE
+// C++ models driven by the RTL through DPI, saved after the model
+static void models_save (VerilatedSerialize& os, const Channel& channel) {
+    lpddr4_model().save(os);
+    phy_csr().save(os);
+    channel.save(os);
+#ifdef SIM_DFI
+    dfi_model().save(os);
+#else
+    serdes_bus().save(os);
+#endif
+}
+
+static void models_restore (VerilatedDeserialize& is, Channel& channel) {
+    lpddr4_model().restore(is);
+    phy_csr().restore(is);
+    channel.restore(is);
+#ifdef SIM_DFI
+    dfi_model().restore(is);
+#else
+    serdes_bus().restore(is);
+#endif
+}
+
+static bool snapshot_save (const std::string& path, Vsim_top* top,
+                           SimState& state, const Channel& channel, uint64_t firmware) {
+    SnapshotSave os;
+    if (!os.open(path))
+        return false;
+
+    SnapshotHeader hdr = {};
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+    hdr.version  = SNAPSHOT_VERSION;
+    hdr.firmware = firmware;
+
+    os.write(&hdr, sizeof(hdr));
+    os << *top;
+    os.write(&state, sizeof(state));
+    models_save(os, channel);
+    os.close();
+    return true;
+}
+
+static bool snapshot_restore (const std::string& path, Vsim_top* top,
+                              SimState& state, Channel& channel, uint64_t firmware) {
+    SnapshotRestore is;
+    if (!is.open(path)) {
+        fprintf(stderr, "Cannot open snapshot '%s'\n", path.c_str());
+        return false;
+    }
+
+    SnapshotHeader hdr;
+    is.read(&hdr, sizeof(hdr));
+    if (memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) ||
+        hdr.version != SNAPSHOT_VERSION) {
+        fprintf(stderr, "'%s' is not a snapshot of this testbench\n", path.c_str());
+        return false;
+    }
+    if (hdr.firmware != firmware) {
+        fprintf(stderr, "Snapshot '%s' was taken with a different firmware\n", path.c_str());
+        return false;
+    }
+
+    is >> *top;
+    is.read(&state, sizeof(state));
+    models_restore(is, channel);
+    return true;
+}
+#endif
+
 int main (int argc, char* argv[]) {
 
     Verilated::commandArgs(argc, argv);
+    parse_plusargs(argc, argv);
+
+    g_trace.enabled = plusarg_has("trace") ||
+                      plusarg_has("trace_start") ||
+                      plusarg_has("trace_end") ||
+                      plusarg_has("trace_trigger");
+    g_trace.has_trigger = plusarg_has("trace_trigger");
+    g_trace.triggered = !g_trace.has_trigger;
+    g_trace.trigger = mem_word(strtoull(plusarg_str("trace_trigger", "0").c_str(), NULL, 16));
+    g_trace.start = plusarg_u64("trace_start", 0);
+    g_trace.end   = plusarg_u64("trace_end", UINT64_MAX);
+    g_trace.depth = (int)plusarg_u64("trace_depth", 24);
+
+#if VM_TRACE
+    // Must be called before the model is constructed
+    if (g_trace.enabled)
+        Verilated::traceEverOn(true);
+#else
+    if (g_trace.enabled) {
+        fprintf(stderr, "Tracing requested but the model was built without it\n");
+        g_trace.enabled = false;
+    }
+#endif
 
     // Instantiate the top module
     Vsim_top* top = new Vsim_top;
 
+    SimState state = {};
+
+    // Load the firmware. Without an ELF file ROM is initialized from rom.hex.
+    // Symbols are needed on restore as well.
+    ElfImage elf;
+    top->boot_addr_i = BOOT_ADDR;
+    if (plusarg_has("elf")) {
+        std::string path = plusarg_str("elf", "");
+        if (!elf.load(path))
+            return EXIT_ERROR;
+        if (!plusarg_has("restore") && !load_elf(top, path, elf))
+            return EXIT_ERROR;
+    }
+
+#if defined(SIM_CPP_CLOCKS) && defined(SIM_DFI)
+    // The DFI build has no PHY clocks
+    ClockSchedule clocks(ClockSchedule::CLK_SYS);
+#elif defined(SIM_CPP_CLOCKS)
+    // sys8x is only needed by bit level serdes models
+    ClockSchedule clocks(plusarg_has("sys8x") ? ClockSchedule::CLK_ALL :
+                         ClockSchedule::CLK_ALL & ~ClockSchedule::CLK_SYS8X);
+#endif
+
+#ifdef SIM_SAVABLE
+    // Snapshots are tied to the firmware image they were taken with
+    uint64_t firmware = firmware_hash(plusarg_str("firmware", plusarg_str("elf", "rom.hex")));
+
+    g_snapshot.file = plusarg_str("save_file", "snapshot.bin.gz");
+    if (plusarg_has("save_at")) {
+        std::string at = plusarg_str("save_at", "");
+        if (!at.empty() && at[0] == '@') {
+            g_snapshot.has_trigger = true;
+            g_snapshot.trigger = mem_word(strtoull(at.c_str() + 1, NULL, 16));
+        } else {
+            g_snapshot.cycle = strtoull(at.c_str(), NULL, 0);
+        }
+    }
+#else
+    if (plusarg_has("save_at") || plusarg_has("restore")) {
+        fprintf(stderr, "Snapshots requested but the model was built without SAVABLE=1\n");
+        return EXIT_ERROR;
+    }
+#endif
+
     // Init trace dump
 #if VM_TRACE
-    VerilatedVcdC* trace = NULL;
-    Verilated::traceEverOn(true);
-    trace = new VerilatedVcdC;
-    top->trace(trace, 24);
-    trace->open("dump.vcd");
+    TraceFile* trace = NULL;
+    if (g_trace.enabled) {
+        trace = new TraceFile;
+        top->trace(trace, g_trace.depth);
+        trace->open(plusarg_str("trace_file", TRACE_FILE_DEFAULT).c_str());
+    }
+#endif
+
+    // Host channel
+    std::string stdout_file = plusarg_str("stdout_file", "stdout.txt");
+    if (!g_host.open(stdout_file.c_str()))
+        fprintf(stderr, "Cannot open '%s'\n", stdout_file.c_str());
+
+    g_host.setDumpPrefix(plusarg_str("dump_prefix", "dump"));
+    g_host.setReadByte([](uint32_t addr) {
+        svSetScope(svGetScopeFromName("TOP.sim_top"));
+        if (addr & (1u << 17))
+            return (uint8_t)(sim_ram_read(mem_word(addr)) >> (8 * (addr & 3)));
+        else
+            return (uint8_t)sim_rom_read(addr & ((1u << 17) - 1));
+    });
+
+    // UART receiver
+    UartRx uart;
+    std::string uart_file = plusarg_str("uart_file", "uart.txt");
+    if (!uart.open(uart_file.c_str()))
+        fprintf(stderr, "Cannot open '%s'\n", uart_file.c_str());
+
+    // DRAM device command log
+    FILE* lpddr4_log = nullptr;
+    if (plusarg_has("lpddr4_log")) {
+        std::string path = plusarg_str("lpddr4_log", "lpddr4.log");
+        lpddr4_log = fopen(path.c_str(), "w");
+        if (!lpddr4_log)
+            fprintf(stderr, "Cannot open '%s'\n", path.c_str());
+        lpddr4_model().setLog(lpddr4_log);
+    }
+
+    // Non-ideal DRAM channel, follows the delays set in the PHY
+    Channel channel;
+    bool has_channel = plusarg_has("channel");
+    if (has_channel) {
+        std::string csv = plusarg_str("csr_csv", SIM_CSR_CSV);
+        if (!channel.load(plusarg_str("channel", "channel.yml")) || !phy_csr().load(csv))
+            return EXIT_ERROR;
+        channel.setPhy(&phy_csr());
+        lpddr4_model().setChannel(&channel);
+    }
+
+#ifdef SIM_DFI
+    // Transaction level PHY in place of phy_core. It drives the device
+    // through the channel set above or an ideal one.
+    {
+        std::string csv = plusarg_str("csr_csv", SIM_CSR_CSV);
+        if ((!phy_csr().loaded() && !phy_csr().load(csv)) || !dfi_model().load(csv))
+            return EXIT_ERROR;
+    }
+#else
+    // Word level serdes models, matched with the DRAM pads by instance name
+    if (!serdes_bus().load(plusarg_str("serdes_map", SIM_SERDES_MAP)))
+        fprintf(stderr, "[sim] Serdes models left idle\n");
+#endif
+
+#ifdef SIM_SAVABLE
+    // The C++ models are restored over their loaded configuration
+    if (plusarg_has("restore")) {
+        std::string path = plusarg_str("restore", "");
+        if (!snapshot_restore(path, top, state, channel, firmware))
+            return EXIT_ERROR;
+
+        g_time = state.time;
+        clocks.seek(state.clock_pos);
+        fprintf(stderr, "[sim] Restored '%s' at cycle %llu\n",
+                path.c_str(), (unsigned long long)state.cycle);
+    }
 #endif
 
+    // DFI init trigger. The simulation ends once the firmware went through
+    // the requested number of inits and saw the trigger released.
+    InitTrigger init(plusarg_u64("init_trigger", 0),
+                     (uint32_t)plusarg_u64("init_count", 1),
+                     plusarg_u64("init_hold", 0));
+    if (plusarg_has("restore"))
+        init.setState(state.init);
+    top->dfi_init_start_i = state.init_start;
+
     // Simulate
-    while (!Verilated::gotFinish()){
+    uint64_t cycle = state.cycle;
+    uint64_t evals = 0;
+    uint8_t  clk_prev = state.clk_prev;
+
+    // Cycle budget and no-progress watchdog, 0 disables them. The watchdog
+    // is opt-in, a firmware waiting for the init trigger legitimately spins
+    // in a polling loop.
+    uint64_t max_cycles = plusarg_u64("max_cycles", 0);
+    uint64_t hang_limit = plusarg_u64("watchdog", 0);
+    Watchdog watchdog(hang_limit, cycle);
+
+    SimReport report;
+    report.start(cycle);
+    g_host.setMarkHandler([&](uint32_t phase, const std::string& name) {
+        report.mark(phase, name, cycle);
+    });
+
+    bool timeout = false;
+    while (!Verilated::gotFinish() && !g_host.finished() && !init.finished() &&
+           !timeout && !watchdog.fired()){
+#ifdef SIM_CPP_CLOCKS
+        // Apply the next clock edge and evaluate
+        uint8_t levels;
+        g_time = clocks.next(&levels);
+
+        top->clk_i        = !!(levels & ClockSchedule::CLK_SYS);
+        top->clk_sys2x_i  = !!(levels & ClockSchedule::CLK_SYS2X);
+        top->clk_sys8x_i  = !!(levels & ClockSchedule::CLK_SYS8X);
+        top->clk_idelay_i = !!(levels & ClockSchedule::CLK_IDELAY);
+        top->eval();
+        evals++;
+
+#if VM_TRACE
+        if (trace && g_trace.active(cycle))
+            trace->dump(g_time);
+#endif
+#else
 #if VM_TRACE
-        trace->dump(g_time);
+        if (trace && g_trace.active(cycle))
+            trace->dump(g_time);
 #endif
         top->eval();
+        evals++;
         g_time += 1;
+#endif
+
+        // Count sys clock cycles, sample UART TX once per cycle
+        if (top->clk_o && !clk_prev) {
+            cycle++;
+            g_host.tick();
+            uart.tick(top->uart_tx_o, top->uart_nco_o);
+            watchdog.tick(cycle,
+                          top->rom_req_o, top->rom_addr_o,
+                          top->ram_req_o, top->ram_we_o,
+                          top->ram_addr_o, top->ram_wdata_o);
+            timeout = (max_cycles != 0 && cycle >= max_cycles);
+            top->dfi_init_start_i = init.tick(cycle, top->dfi_init_done_o);
+        }
+        clk_prev = top->clk_o;
+
+#ifdef SIM_SAVABLE
+        // Take a snapshot in between evaluations
+        if (cycle == g_snapshot.cycle && clk_prev) {
+            g_snapshot.cycle = UINT64_MAX;
+            g_snapshot.pending = true;
+        }
+        if (g_snapshot.pending) {
+            g_snapshot.pending = false;
+
+            state.time      = g_time;
+            state.cycle     = cycle;
+            state.clock_pos = clocks.position();
+            state.clk_prev  = clk_prev;
+            state.init_start = top->dfi_init_start_i;
+            state.init      = init.state();
+
+            if (snapshot_save(g_snapshot.file, top, state, channel, firmware))
+                fprintf(stderr, "[sim] Saved '%s' at cycle %llu\n",
+                        g_snapshot.file.c_str(), (unsigned long long)cycle);
+            else
+                fprintf(stderr, "Cannot write snapshot '%s'\n", g_snapshot.file.c_str());
+        }
+#endif
+
+#if VM_TRACE
+        // Close the trace as soon as the window is over
+        if (trace && trace->isOpen() && cycle >= g_trace.end)
+            trace->close();
+#endif
     }
 
     // Close trace dump
 #if VM_TRACE
-    trace->close();
+    if (trace) {
+        if (trace->isOpen())
+            trace->close();
+        delete trace;
+    }
 #endif
 
-    return 0;
-}
+    // Tell how the simulation ended
+    SimExit     result;
+    const char* status;
+    if (g_host.trapped()) {
+        result = EXIT_EXCEPTION;
+        status = "exception";
+        fprintf(stderr, "[sim] Exception at cycle %llu: mcause 0x%X, mepc 0x%08X\n",
+                (unsigned long long)cycle, g_host.mcause(), g_host.mepc());
+    } else if (g_host.finished()) {
+        result = g_host.exitCode() ? EXIT_FAIL : EXIT_PASS;
+        status = g_host.exitCode() ? "fail" : "pass";
+        if (g_host.exitCode())
+            fprintf(stderr, "[sim] Firmware exited with %d\n", g_host.exitCode());
+    } else if (init.finished()) {
+        result = EXIT_PASS;
+        status = "init done";
+    } else if (timeout) {
+        result = EXIT_TIMEOUT;
+        status = "timeout";
+        fprintf(stderr, "[sim] Cycle budget of %llu cycles exhausted\n",
+                (unsigned long long)max_cycles);
+    } else if (watchdog.fired()) {
+        result = EXIT_HANG;
+        status = "hang";
+        fprintf(stderr, "[sim] No progress for %llu cycles, firmware hung at cycle %llu\n",
+                (unsigned long long)hang_limit,
+                (unsigned long long)cycle);
+    } else {
+        result = EXIT_PASS;
+        status = "finish";
+    }
+
+    if (result == EXIT_EXCEPTION || result == EXIT_TIMEOUT || result == EXIT_HANG)
+        watchdog.dump(stderr);
+
+    g_host.close();
+    uart.close();
+    if (uart.frameErrors())
+        fprintf(stderr, "[sim] UART: %llu frame errors\n",
+                (unsigned long long)uart.frameErrors());
+
+    const Lpddr4::Stats& dram = lpddr4_model().stats();
+    if (dram.act || dram.mrw || dram.errors)
+        fprintf(stderr, "[sim] LPDDR4: %llu ACT, %llu RD, %llu WR, %llu MRW, "
+                        "%llu MRR, %llu MPC, %llu protocol errors\n",
+                (unsigned long long)dram.act, (unsigned long long)dram.rd,
+                (unsigned long long)dram.wr, (unsigned long long)dram.mrw,
+                (unsigned long long)dram.mrr, (unsigned long long)dram.mpc,
+                (unsigned long long)dram.errors);
+    if (serdes_bus().active())
+        fprintf(stderr, "[sim] Serdes: %zu instances, %llu words, %llu CK/DQS edges\n",
+                serdes_bus().instances(),
+                (unsigned long long)serdes_bus().words(),
+                (unsigned long long)serdes_bus().edges());
+#ifdef SIM_DFI
+    fprintf(stderr, "[sim] DFI: %llu CSR writes, %llu commands, %llu bursts\n",
+            (unsigned long long)dfi_model().stats().writes,
+            (unsigned long long)dfi_model().stats().commands,
+            (unsigned long long)dfi_model().stats().bursts);
+#endif
+    if (lpddr4_log)
+        fclose(lpddr4_log);
+
+    // Report simulation performance
+    report.stop(cycle, sim_time_ns(), evals, status, result);
+    report.print(stderr);
 
+    // End-to-end time of every init, from the trigger to init done
+    for (size_t i = 0; i < init.durations().size(); ++i)
+        report.metric(i ? "init_cycles_" + std::to_string(i + 1) : "init_cycles",
+                      init.durations()[i]);
+
+    // Leveling effort, to compare the window search strategies
+    int tap_evals, wait_cycles;
+    read_symbol(elf, "sdram_tap_evaluations", &tap_evals, 1);
+    read_symbol(elf, "sdram_wait_total", &wait_cycles, 1);
+    if (tap_evals >= 0) {
+        fprintf(stderr, "[sim] Leveling: %d tap evaluations, %d cycles waiting\n",
+                tap_evals, wait_cycles);
+        report.metric("tap_evaluations", tap_evals);
+        report.metric("wait_cycles", wait_cycles);
+    }
+
+    // Training results of the firmware against the injected channel
+    if (has_channel) {
+        Channel::Result picked;
+        read_symbol(elf, "read_dq_delay",     picked.readDelay,  Channel::LANES);
+        read_symbol(elf, "write_dq_delay",    picked.writeDelay, Channel::LANES);
+        read_symbol(elf, "sdram_clock_delay", &picked.clockDelay, 1);
+        if (elf.symbols.empty())
+            fprintf(stderr, "[sim] No firmware symbols, run with +elf to compare training results\n");
+        channel.report(picked, report, stderr);
+    }
+
+    if (plusarg_has("report")) {
+        std::string path = plusarg_str("report", "report.json");
+        if (!report.writeJson(path))
+            fprintf(stderr, "Cannot write '%s'\n", path.c_str());
+    }
+
+    // Firmware symbols are read from the RAM model, keep it until the end
+    top->final();
+    delete top;
+
+    return result;
+}
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2023 Antmicro <www.antmicro.com>
+# SPDX-License-Identifier: Apache-2.0
+
+"""
+Runs firmware tests from tests/src in parallel on a single Vsim_top build.
+
+Every test is built with its own Makefile and run in an isolated work
+directory. A test passes when Vsim_top exits with 0 and every output file
+matches its golden counterpart in the test directory ("<name>.golden" is
+compared with "<name>.txt", e.g. uart.golden with uart.txt). The exit status
+is written to status.txt, a test of a failure path gives the status it has
+to end with in status.golden (e.g. "exception") and passes when that and
+the other outputs match.
+"""
+
+import os
+import sys
+import json
+import time
+import difflib
+import argparse
+import subprocess
+import concurrent.futures
+
+from xml.etree import ElementTree as ET
+
+# Vsim_top exit codes, see src/testbench.cpp
+EXIT_CODES = {
+    0: "pass",
+    1: "fail",
+    2: "timeout",
+    3: "hang",
+    4: "exception",
+    5: "error",
+}
+
+# Tests -------------------------------------------------------------------------------------------
+
+def find_tests(tests_dir, names):
+    tests = sorted(d for d in os.listdir(tests_dir)
+                   if os.path.isfile(os.path.join(tests_dir, d, "Makefile")))
+    if names:
+        unknown = set(names) - set(tests)
+        if unknown:
+            raise SystemExit("Unknown tests: {}".format(", ".join(sorted(unknown))))
+        tests = [t for t in tests if t in names]
+    return tests
+
+
+def build_firmware(test, tests_dir, build_dir):
+    """Builds the firmware of a test. Returns the ELF file path and the build log."""
+    makefile = os.path.join(tests_dir, test, "Makefile")
+    proc = subprocess.run(["make", "-f", makefile, "build"], cwd=build_dir,
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    elf = os.path.join(build_dir, test, test + ".elf")
+    return (elf if proc.returncode == 0 else None), proc.stdout
+
+
+def check_outputs(test_dir, work_dir):
+    """Compares output files with golden ones. Returns a list of diffs."""
+    diffs = []
+    for name in sorted(os.listdir(test_dir)):
+        if not name.endswith(".golden"):
+            continue
+
+        golden = os.path.join(test_dir, name)
+        output = os.path.join(work_dir, name[:-len(".golden")] + ".txt")
+
+        with open(golden, errors="replace") as f:
+            expected = f.readlines()
+        actual = []
+        if os.path.isfile(output):
+            with open(output, errors="replace") as f:
+                actual = f.readlines()
+
+        diff = "".join(difflib.unified_diff(expected, actual, golden, output))
+        if diff:
+            diffs.append(diff)
+    return diffs
+
+
+def run_test(test, args):
+    result = {
+        "name":   test,
+        "status": "error",
+        "exit":   None,
+        "time":   0.0,
+        "cycles": None,
+        "log":    "",
+        "diffs":  [],
+    }
+
+    start = time.monotonic()
+    work_dir = os.path.join(args.work_dir, test)
+    os.makedirs(work_dir, exist_ok=True)
+
+    elf, log = build_firmware(test, args.tests_dir, args.build_dir)
+    if elf is None:
+        result["log"] = log
+        result["time"] = time.monotonic() - start
+        return result
+
+    cmd = [args.vsim, "+elf=" + elf, "+report=report.json"]
+    if args.max_cycles:
+        cmd.append("+max_cycles={}".format(args.max_cycles))
+    if args.watchdog:
+        cmd.append("+watchdog={}".format(args.watchdog))
+
+    with open(os.path.join(work_dir, "sim.log"), "w") as f:
+        proc = subprocess.run(cmd, cwd=work_dir, stdout=f, stderr=subprocess.STDOUT)
+
+    result["exit"] = EXIT_CODES.get(proc.returncode, "error")
+    with open(os.path.join(work_dir, "status.txt"), "w") as f:
+        f.write(result["exit"] + "\n")
+
+    test_dir = os.path.join(args.tests_dir, test)
+    result["diffs"] = check_outputs(test_dir, work_dir)
+    if os.path.isfile(os.path.join(test_dir, "status.golden")):
+        result["status"] = "fail" if result["diffs"] else "pass"
+    else:
+        result["status"] = result["exit"]
+        if result["status"] == "pass" and result["diffs"]:
+            result["status"] = "fail"
+
+    try:
+        with open(os.path.join(work_dir, "report.json")) as f:
+            result["cycles"] = json.load(f)["cycles"]
+    except (OSError, ValueError, KeyError):
+        pass
+
+    with open(os.path.join(work_dir, "sim.log"), errors="replace") as f:
+        result["log"] = f.read()
+
+    result["time"] = time.monotonic() - start
+    return result
+
+# Reports -----------------------------------------------------------------------------------------
+
+def write_junit(path, results):
+    suite = ET.Element("testsuite", name="sim-tests",
+                       tests=str(len(results)),
+                       failures=str(sum(r["status"] != "pass" for r in results)),
+                       time="{:.3f}".format(sum(r["time"] for r in results)))
+    for r in results:
+        case = ET.SubElement(suite, "testcase", classname="sim", name=r["name"],
+                             time="{:.3f}".format(r["time"]))
+        if r["status"] != "pass":
+            failure = ET.SubElement(case, "failure", message=r["status"])
+            failure.text = "\n".join(r["diffs"])
+        ET.SubElement(case, "system-out").text = r["log"]
+    ET.ElementTree(suite).write(path, encoding="utf-8", xml_declaration=True)
+
+
+def write_json(path, results):
+    with open(path, "w") as f:
+        json.dump([{k: r[k] for k in ("name", "status", "exit", "time", "cycles", "diffs")}
+                   for r in results], f, indent=2)
+
+# Main --------------------------------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--vsim",       required=True, help="Vsim_top binary")
+    parser.add_argument("--tests-dir",  required=True, help="Directory with firmware tests")
+    parser.add_argument("--build-dir",  required=True, help="Firmware build directory")
+    parser.add_argument("--work-dir",   required=True, help="Directory for test work dirs")
+    parser.add_argument("--jobs", "-j", type=int, default=os.cpu_count(),
+                        help="Number of tests to run concurrently")
+    parser.add_argument("--max-cycles", type=int, default=0, help="Cycle budget of a test")
+    parser.add_argument("--watchdog",   type=int, default=0,
+                        help="Cycles without progress after which a test counts as hung")
+    parser.add_argument("--junit",      help="Write a JUnit XML summary")
+    parser.add_argument("--json",       help="Write a JSON summary")
+    parser.add_argument("tests", nargs="*", help="Tests to run (all by default)")
+    args = parser.parse_args()
+
+    args.vsim      = os.path.abspath(args.vsim)
+    args.tests_dir = os.path.abspath(args.tests_dir)
+    args.build_dir = os.path.abspath(args.build_dir)
+    args.work_dir  = os.path.abspath(args.work_dir)
+    os.makedirs(args.build_dir, exist_ok=True)
+
+    tests = find_tests(args.tests_dir, args.tests)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        results = list(pool.map(lambda t: run_test(t, args), tests))
+
+    for r in results:
+        cycles = "" if r["cycles"] is None else "{} cycles".format(r["cycles"])
+        ended = "" if r["exit"] in (None, r["status"]) else "({})".format(r["exit"])
+        print("{:<24} {:<10} {:<11} {:8.1f} s  {}".format(r["name"], r["status"].upper(), ended,
+                                                           r["time"], cycles))
+        for diff in r["diffs"]:
+            print(diff)
+
+    if args.junit:
+        write_junit(args.junit, results)
+    if args.json:
+        write_json(args.json, results)
+
+    failed = [r["name"] for r in results if r["status"] != "pass"]
+    print("{} of {} tests passed".format(len(results) - len(failed), len(results)))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,12 @@
+/* Copyright Antmicro 2023
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Executes an illegal instruction. The exception handler of crt0.S reports
+// it to the simulator, which has to end with the exception exit code.
+int main(int argc, char* argv[]) {
+
+    __asm__ volatile ("unimp");
+
+    return 0;
+}